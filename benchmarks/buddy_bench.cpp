@@ -0,0 +1,78 @@
+/******************************************************************************/
+/*
+* @file   buddy_bench.cpp
+* @author Aditya Harsh
+* @brief  BuddyAllocator against malloc for random sizes from 256 B to 1 MB.
+*/
+/******************************************************************************/
+
+#include "../buddyallocator.h"
+
+#include <chrono>   /* std::chrono  */
+#include <cstdlib>  /* std::malloc  */
+#include <iostream> /* std::cout    */
+#include <random>   /* std::mt19937 */
+#include <vector>   /* std::vector  */
+
+#define LIVE 64
+#define OPS 1000000
+
+template <typename Fn>
+static double time_ms(Fn fn)
+{
+    auto start = std::chrono::steady_clock::now();
+    fn();
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main()
+{
+    // log-uniform sizes, so small and large buffers are equally common
+    std::mt19937 rng(42);
+    std::vector<size_t> sizes(OPS);
+    std::vector<size_t> victims(OPS);
+    for (size_t i = 0; i < OPS; ++i)
+    {
+        sizes[i] = size_t(1) << (8 + rng() % 13);
+        sizes[i] += rng() % sizes[i];
+        if (sizes[i] > (size_t(1) << 20)) sizes[i] = size_t(1) << 20;
+        victims[i] = rng() % LIVE;
+    }
+
+    // 64 live buffers of up to 1 MB each fit in 128 MB even after rounding
+    auto* buddy = new ATL::BuddyAllocator<8, 27, ATL::MappedStorage>;
+    std::vector<void*> live(LIVE, nullptr);
+    size_t sum = 0;
+
+    double b = time_ms([&] {
+        for (size_t i = 0; i < OPS; ++i)
+        {
+            void*& slot = live[victims[i]];
+            if (slot) buddy->Free(slot);
+            slot = buddy->Allocate(sizes[i]);
+            static_cast<char*>(slot)[0] = 1;
+            sum += reinterpret_cast<size_t>(slot) & 0xFF;
+        }
+        for (void*& slot : live) { buddy->Free(slot); slot = nullptr; }
+    });
+
+    double m = time_ms([&] {
+        for (size_t i = 0; i < OPS; ++i)
+        {
+            void*& slot = live[victims[i]];
+            std::free(slot);
+            slot = std::malloc(sizes[i]);
+            static_cast<char*>(slot)[0] = 1;
+            sum += reinterpret_cast<size_t>(slot) & 0xFF;
+        }
+        for (void*& slot : live) { std::free(slot); slot = nullptr; }
+    });
+
+    delete buddy;
+
+    std::cout << "buddy:  " << b << " ms\n";
+    std::cout << "malloc: " << m << " ms\n";
+    std::cout << "(checksum " << sum << ")\n";
+
+    return 0;
+}
@@ -0,0 +1,111 @@
+/******************************************************************************/
+/*
+* @file   containers_bench.cpp
+* @author Aditya Harsh
+* @brief  Pool-backed containers against std::list, std::unordered_map and
+*         std::map.
+*/
+/******************************************************************************/
+
+#include "../poolcontainers.h"
+
+#include <algorithm>     /* std::shuffle        */
+#include <chrono>        /* std::chrono         */
+#include <iostream>      /* std::cout           */
+#include <list>          /* std::list           */
+#include <map>           /* std::map            */
+#include <random>        /* std::mt19937        */
+#include <unordered_map> /* std::unordered_map  */
+#include <vector>        /* std::vector         */
+
+#define SIZE 200000
+
+template <typename Fn>
+static double time_ms(Fn fn)
+{
+    auto start = std::chrono::steady_clock::now();
+    fn();
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+static void report(const char* name, double pool, double std_ms)
+{
+    std::cout << name << ": pool " << pool << " ms, std " << std_ms << " ms\n";
+}
+
+int main()
+{
+    // scrambled keys so the ordered structures do real work
+    std::vector<int> keys(SIZE);
+    for (int i = 0; i < SIZE; ++i)
+        keys[static_cast<size_t>(i)] = static_cast<int>((static_cast<unsigned>(i) * 2654435761u) % 1000000007u);
+
+    // lookups and erases in an order unrelated to insertion, which would
+    // otherwise visit malloc'd nodes in address order
+    std::vector<int> finds(keys), erases(keys);
+    std::shuffle(finds.begin(), finds.end(), std::mt19937(1));
+    std::shuffle(erases.begin(), erases.end(), std::mt19937(2));
+
+    long long sum = 0;
+
+    {
+        auto* pool = new ATL::PoolList<int, SIZE>;
+        std::list<int> std_list;
+
+        double p = time_ms([&] {
+            for (int k : keys) pool->PushBack(k);
+            for (int v : *pool) sum += v;
+            pool->Clear();
+        });
+        double s = time_ms([&] {
+            for (int k : keys) std_list.push_back(k);
+            for (int v : std_list) sum += v;
+            std_list.clear();
+        });
+
+        report("list     push/iterate/clear", p, s);
+        delete pool;
+    }
+
+    {
+        auto* pool = new ATL::PoolHashMap<int, int, SIZE>;
+        std::unordered_map<int, int> std_map;
+
+        double p = time_ms([&] {
+            for (int k : keys) pool->Emplace(k, k);
+            for (int k : finds) sum += pool->Find(k)->value;
+            for (int k : erases) pool->Erase(k);
+        });
+        double s = time_ms([&] {
+            for (int k : keys) std_map.emplace(k, k);
+            for (int k : finds) sum += std_map.find(k)->second;
+            for (int k : erases) std_map.erase(k);
+        });
+
+        report("hash map insert/find/erase ", p, s);
+        delete pool;
+    }
+
+    {
+        auto* pool = new ATL::PoolSkipList<int, int, SIZE>;
+        std::map<int, int> std_map;
+
+        double p = time_ms([&] {
+            for (int k : keys) pool->Emplace(k, k);
+            for (int k : finds) sum += pool->Find(k)->value;
+            for (int k : erases) pool->Erase(k);
+        });
+        double s = time_ms([&] {
+            for (int k : keys) std_map.emplace(k, k);
+            for (int k : finds) sum += std_map.find(k)->second;
+            for (int k : erases) std_map.erase(k);
+        });
+
+        report("skiplist insert/find/erase ", p, s);
+        delete pool;
+    }
+
+    std::cout << "(checksum " << sum << ")\n";
+
+    return 0;
+}
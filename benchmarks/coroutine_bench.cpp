@@ -0,0 +1,78 @@
+/******************************************************************************/
+/*
+* @file   coroutine_bench.cpp
+* @author Aditya Harsh
+* @brief  Millions of short-lived coroutines, pooled frames against the heap.
+*         Needs C++20.
+*/
+/******************************************************************************/
+
+#include "../coroutineallocator.h"
+
+#include <chrono>    /* std::chrono          */
+#include <coroutine> /* std::coroutine_handle */
+#include <iostream>  /* std::cout            */
+
+#define COUNT 5000000
+
+// lazily started task producing an int, frames allocated through Base
+template <typename Base>
+struct Task
+{
+    struct promise_type : Base
+    {
+        int value = 0;
+
+        Task get_return_object() noexcept { return Task{std::coroutine_handle<promise_type>::from_promise(*this)}; }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        std::suspend_always final_suspend() noexcept { return {}; }
+        void return_value(int v) noexcept { value = v; }
+        void unhandled_exception() noexcept {}
+    };
+
+    std::coroutine_handle<promise_type> handle;
+
+    explicit Task(std::coroutine_handle<promise_type> h) noexcept : handle(h) {}
+    Task(Task&& rhs) noexcept : handle(rhs.handle) { rhs.handle = nullptr; }
+    Task& operator=(Task&& rhs) = delete;
+    ~Task() { if (handle) handle.destroy(); }
+
+    int Get()
+    {
+        handle.resume();
+        return handle.promise().value;
+    }
+};
+
+struct HeapFrames {};
+
+template <typename Base>
+static Task<Base> add(int a, int b)
+{
+    co_return a + b;
+}
+
+template <typename Base>
+static double run(long long& sum)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    for (int i = 0; i < COUNT; ++i)
+        sum += add<Base>(i, 1).Get();
+
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main()
+{
+    long long sum = 0;
+
+    double pooled = run<ATL::PooledPromise<>>(sum);
+    double heap = run<HeapFrames>(sum);
+
+    std::cout << "pooled frames: " << pooled << " ms\n";
+    std::cout << "heap frames:   " << heap << " ms\n";
+    std::cout << "(checksum " << sum << ")\n";
+
+    return 0;
+}
@@ -0,0 +1,71 @@
+/******************************************************************************/
+/*
+* @file   forwarding_bench.cpp
+* @author Aditya Harsh
+* @brief  TypeAllocator construction from rvalue payloads: forwarded (moved)
+*         against the old copying construction.
+*/
+/******************************************************************************/
+
+#include "../memoryallocator.h"
+
+#include <chrono>   /* std::chrono */
+#include <iostream> /* std::cout   */
+#include <string>   /* std::string */
+#include <vector>   /* std::vector */
+
+#define COUNT 1000000
+
+struct Message
+{
+    std::string topic;
+    std::vector<char> payload;
+
+    Message(std::string t, std::vector<char> p) : topic(std::move(t)), payload(std::move(p)) {}
+};
+
+template <typename Fn>
+static double time_ms(Fn fn)
+{
+    auto start = std::chrono::steady_clock::now();
+    fn();
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main()
+{
+    auto* alloc = new ATL::TypeAllocator<Message, 16>;
+    size_t sum = 0;
+
+    double forwarded = time_ms([&] {
+        for (int i = 0; i < COUNT; ++i)
+        {
+            std::string topic(64, 't');
+            std::vector<char> payload(512, 'p');
+
+            auto msg = alloc->Make(std::move(topic), std::move(payload));
+            sum += msg->payload.size();
+        }
+    });
+
+    double copied = time_ms([&] {
+        for (int i = 0; i < COUNT; ++i)
+        {
+            std::string topic(64, 't');
+            std::vector<char> payload(512, 'p');
+
+            // what Allocate(args...) did before: construct from lvalues
+            Message* msg = new(alloc->base::Allocate()) Message(topic, payload);
+            sum += msg->payload.size();
+            alloc->Free(msg);
+        }
+    });
+
+    delete alloc;
+
+    std::cout << "forwarded: " << forwarded << " ms\n";
+    std::cout << "copied:    " << copied << " ms\n";
+    std::cout << "(checksum " << sum << ")\n";
+
+    return 0;
+}
@@ -0,0 +1,93 @@
+/******************************************************************************/
+/*
+* @file   numa_bench.cpp
+* @author Aditya Harsh
+* @brief  NumaMemoryAllocator against a single mutex-guarded MemoryAllocator.
+*         Runs on single-node machines too, where it measures the overhead.
+*/
+/******************************************************************************/
+
+#include "../memoryallocator.h"
+#include "../numaallocator.h"
+
+#include <algorithm> /* std::min          */
+#include <chrono>    /* std::chrono       */
+#include <iostream>  /* std::cout         */
+#include <mutex>     /* std::mutex        */
+#include <thread>    /* std::thread       */
+#include <vector>    /* std::vector       */
+
+#define BLOCK 64
+#define BATCH 256
+#define ROUNDS 2000
+
+template <typename Fn>
+static double run_threads(unsigned threads, Fn fn)
+{
+    std::vector<std::thread> pool;
+
+    auto start = std::chrono::steady_clock::now();
+
+    for (unsigned t = 0; t < threads; ++t)
+        pool.emplace_back(fn);
+
+    for (auto& th : pool)
+        th.join();
+
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main()
+{
+    const unsigned threads = std::max(1u, std::min(8u, std::thread::hardware_concurrency()));
+
+    ATL::NumaMemoryAllocator<BLOCK, BATCH * 8> numa;
+
+    std::cout << "nodes: " << numa.NodeCount() << ", threads: " << threads << '\n';
+    for (size_t i = 0; i < numa.NodeCount(); ++i)
+        std::cout << "  shard " << i << (numa.IsBound(i) ? " bound" : " unbound (no NUMA support)") << '\n';
+
+    double numa_ms = run_threads(threads, [&numa]
+    {
+        void* blocks[BATCH];
+
+        for (size_t r = 0; r < ROUNDS; ++r)
+        {
+            for (size_t i = 0; i < BATCH; ++i)
+                static_cast<char*>(blocks[i] = numa.Allocate())[0] = 1;
+
+            for (size_t i = 0; i < BATCH; ++i)
+                numa.Free(blocks[i]);
+        }
+    });
+
+    std::mutex lock;
+    auto* shared = new ATL::MemoryAllocator<BLOCK, BATCH * 8>;
+
+    double mutex_ms = run_threads(threads, [&lock, shared]
+    {
+        void* blocks[BATCH];
+
+        for (size_t r = 0; r < ROUNDS; ++r)
+        {
+            for (size_t i = 0; i < BATCH; ++i)
+            {
+                std::lock_guard<std::mutex> guard(lock);
+                static_cast<char*>(blocks[i] = shared->Allocate())[0] = 1;
+            }
+
+            for (size_t i = 0; i < BATCH; ++i)
+            {
+                std::lock_guard<std::mutex> guard(lock);
+                shared->Free(blocks[i]);
+            }
+        }
+    });
+
+    delete shared;
+
+    std::cout << "NumaMemoryAllocator:        " << numa_ms << " ms\n";
+    std::cout << "MemoryAllocator with mutex: " << mutex_ms << " ms\n";
+
+    return 0;
+}
@@ -0,0 +1,83 @@
+/******************************************************************************/
+/*
+* @file   prefetch_bench.cpp
+* @author Aditya Harsh
+* @brief  Allocation bursts from a free list scattered by random-order frees,
+*         with and without prefetching the next free block.
+*/
+/******************************************************************************/
+
+#include "../memoryallocator.h"
+
+#include <algorithm> /* std::shuffle */
+#include <chrono>    /* std::chrono  */
+#include <iostream>  /* std::cout    */
+#include <random>    /* std::mt19937 */
+#include <vector>    /* std::vector  */
+
+#define COUNT (1 << 20)
+#define BLOCK 64
+#define ROUNDS 5
+
+// fills a block with a few dozen cycles of dependent arithmetic, standing in
+// for a constructor that does some work
+static void construct(unsigned long long* object, unsigned long long seed)
+{
+    for (size_t i = 0; i < BLOCK / sizeof(unsigned long long); ++i)
+    {
+        seed ^= seed << 13;
+        seed ^= seed >> 7;
+        seed ^= seed << 17;
+        object[i] = seed;
+    }
+}
+
+template <ATL::Prefetch mode>
+static void run(const char* name)
+{
+    using Pool = ATL::MemoryAllocator<BLOCK, COUNT, ATL::Prefetching<ATL::ReleasePolicy, mode>>;
+
+    auto* pool = new Pool;
+    std::vector<void*> ptrs(COUNT);
+    std::mt19937 rng(1);
+    double best = 0;
+    size_t sum = 0;
+
+    for (int round = 0; round < ROUNDS; ++round)
+    {
+        // scatter the free list
+        for (auto& ptr : ptrs) ptr = pool->Allocate();
+        std::shuffle(ptrs.begin(), ptrs.end(), rng);
+        for (auto* ptr : ptrs) pool->Free(ptr);
+
+        // allocate and construct every block, as a burst of new objects would
+        auto start = std::chrono::steady_clock::now();
+        for (auto& ptr : ptrs)
+        {
+            ptr = pool->Allocate();
+            construct(static_cast<unsigned long long*>(ptr), static_cast<unsigned long long>(round + 1));
+        }
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        for (auto* ptr : ptrs)
+        {
+            sum += *static_cast<unsigned long long*>(ptr) & 1;
+            pool->Free(ptr);
+        }
+
+        if (round == 0 || ms < best) best = ms;
+    }
+
+    delete pool;
+
+    std::cout << name << ": " << best << " ms for " << COUNT << " allocations (checksum " << sum << ")\n";
+}
+
+int main()
+{
+    run<ATL::Prefetch::NONE>("no prefetch     ");
+    run<ATL::Prefetch::LINK>("link            ");
+    run<ATL::Prefetch::LINK_AND_PAYLOAD>("link and payload");
+
+    return 0;
+}
@@ -0,0 +1,68 @@
+/******************************************************************************/
+/*
+* @file   tiny_bench.cpp
+* @author Aditya Harsh
+* @brief  Tiny objects (2 and 4 bytes) in a MemoryAllocator against new:
+*         bytes per block and time to fill, shuffle-free and refill.
+*/
+/******************************************************************************/
+
+#include "../memoryallocator.h"
+
+#include <algorithm> /* std::shuffle  */
+#include <chrono>    /* std::chrono   */
+#include <cstdint>   /* std::uint32_t */
+#include <iostream>  /* std::cout     */
+#include <random>    /* std::mt19937  */
+#include <vector>    /* std::vector   */
+
+#define COUNT 60000
+
+template <typename Fn>
+static double time_ms(Fn fn)
+{
+    auto start = std::chrono::steady_clock::now();
+    fn();
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+template <typename T>
+static void run(const char* name)
+{
+    auto* pool = new ATL::MemoryAllocator<sizeof(T), COUNT>;
+    std::vector<T*> ptrs(COUNT);
+    std::mt19937 rng(1);
+    size_t sum = 0;
+
+    const size_t stride = static_cast<size_t>(static_cast<char*>(pool->FromIndex(1)) - static_cast<char*>(pool->FromIndex(0)));
+
+    double p = time_ms([&] {
+        for (int round = 0; round < 20; ++round)
+        {
+            for (auto& ptr : ptrs) { ptr = static_cast<T*>(pool->Allocate()); *ptr = T(1); }
+            std::shuffle(ptrs.begin(), ptrs.end(), rng);
+            for (auto* ptr : ptrs) { sum += *ptr; pool->Free(ptr); }
+        }
+    });
+
+    double n = time_ms([&] {
+        for (int round = 0; round < 20; ++round)
+        {
+            for (auto& ptr : ptrs) ptr = new T(1);
+            std::shuffle(ptrs.begin(), ptrs.end(), rng);
+            for (auto* ptr : ptrs) { sum += *ptr; delete ptr; }
+        }
+    });
+
+    delete pool;
+
+    std::cout << name << ": pool " << stride << " B/block, " << p << " ms; new " << n << " ms (checksum " << sum << ")\n";
+}
+
+int main()
+{
+    run<std::uint16_t>("2 byte");
+    run<std::uint32_t>("4 byte");
+
+    return 0;
+}
@@ -0,0 +1,110 @@
+/******************************************************************************/
+/*
+* @file   tlsf_bench.cpp
+* @author Aditya Harsh
+* @brief  Per-operation latency of TlsfAllocator against malloc under random
+*         sizes (16 B to 64 KB) and random free order. The tail is what
+*         matters here: TLSF has no path that scans lists, so its worst case
+*         stays close to its median, while malloc occasionally consolidates
+*         or goes to the OS. Each sequence is replayed several times and
+*         every operation keeps its fastest time, which filters out
+*         interrupts and preemption while keeping algorithmic outliers.
+*/
+/******************************************************************************/
+
+#include "../tlsfallocator.h"
+
+#include <algorithm> /* std::sort, std::min */
+#include <chrono>    /* std::chrono         */
+#include <cstdlib>   /* std::malloc         */
+#include <cstring>   /* std::memset         */
+#include <iostream>  /* std::cout           */
+#include <random>    /* std::mt19937        */
+#include <vector>    /* std::vector         */
+
+#define LIVE 4096
+#define OPS 1000000
+#define REPEATS 5
+
+using clock_type = std::chrono::steady_clock;
+
+static void report(const char* name, std::vector<double>& ns)
+{
+    std::sort(ns.begin(), ns.end());
+
+    std::cout << name << ": p50 " << ns[ns.size() / 2] << " ns, p99.99 " << ns[ns.size() - ns.size() / 10000]
+              << " ns, max " << ns.back() << " ns\n";
+}
+
+template <typename Alloc, typename Free>
+static std::vector<double> run(const std::vector<size_t>& sizes, const std::vector<size_t>& victims, Alloc alloc, Free release)
+{
+    std::vector<void*> live(LIVE, nullptr);
+    std::vector<double> ns;
+    ns.reserve(2 * OPS);
+
+    for (size_t i = 0; i < OPS; ++i)
+    {
+        void*& slot = live[victims[i]];
+
+        if (slot)
+        {
+            auto start = clock_type::now();
+            release(slot);
+            ns.push_back(std::chrono::duration<double, std::nano>(clock_type::now() - start).count());
+        }
+
+        auto start = clock_type::now();
+        slot = alloc(sizes[i]);
+        ns.push_back(std::chrono::duration<double, std::nano>(clock_type::now() - start).count());
+
+        static_cast<char*>(slot)[0] = 1;
+    }
+
+    for (void* slot : live)
+        if (slot) release(slot);
+
+    return ns;
+}
+
+int main()
+{
+    // log-uniform sizes, so small and large requests are equally common
+    std::mt19937 rng(7);
+    std::vector<size_t> sizes(OPS);
+    std::vector<size_t> victims(OPS);
+    for (size_t i = 0; i < OPS; ++i)
+    {
+        sizes[i] = size_t(1) << (4 + rng() % 12);
+        sizes[i] += rng() % sizes[i];
+        victims[i] = rng() % LIVE;
+    }
+
+    // 4096 live blocks of at most 64 KB
+    auto* tlsf = new ATL::TlsfAllocator<(size_t(1) << 28), ATL::MappedStorage>;
+
+    // fault the arena in, page faults are not what is measured here
+    void* all = tlsf->Allocate(tlsf->Capacity());
+    std::memset(all, 0, tlsf->Capacity());
+    tlsf->Free(all);
+
+    auto t = run(sizes, victims, [&](size_t n) { return tlsf->Allocate(n); }, [&](void* p) { tlsf->Free(p); });
+    auto m = run(sizes, victims, [](size_t n) { return std::malloc(n); }, [](void* p) { std::free(p); });
+
+    // same sequence, same state: keep each operation's best time
+    for (int r = 1; r < REPEATS; ++r)
+    {
+        auto t2 = run(sizes, victims, [&](size_t n) { return tlsf->Allocate(n); }, [&](void* p) { tlsf->Free(p); });
+        auto m2 = run(sizes, victims, [](size_t n) { return std::malloc(n); }, [](void* p) { std::free(p); });
+
+        for (size_t i = 0; i < t.size(); ++i) t[i] = std::min(t[i], t2[i]);
+        for (size_t i = 0; i < m.size(); ++i) m[i] = std::min(m[i], m2[i]);
+    }
+
+    delete tlsf;
+
+    report("tlsf  ", t);
+    report("malloc", m);
+
+    return 0;
+}
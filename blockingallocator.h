@@ -0,0 +1,209 @@
+/******************************************************************************/
+/*
+* @file   blockingallocator.h
+* @author Aditya Harsh
+* @brief  Thread-safe fixed-size allocator whose callers can wait for a block
+*         to be freed instead of failing. Linux only (futex).
+*/
+/******************************************************************************/
+
+#pragma once
+
+#include "memoryallocator.h" /* ATL::MemoryAllocator */
+#include "spinlock.h"        /* ATL::SpinLock        */
+
+#include <atomic>  /* std::atomic      */
+#include <cerrno>  /* errno            */
+#include <chrono>  /* std::chrono      */
+#include <cstdint> /* std::uint32_t    */
+#include <ctime>   /* timespec         */
+#include <mutex>   /* std::lock_guard  */
+
+#include <linux/futex.h> /* FUTEX_WAIT_PRIVATE, FUTEX_WAKE_PRIVATE */
+#include <sys/syscall.h> /* SYS_futex                              */
+#include <unistd.h>      /* syscall                                */
+
+namespace ATL
+{
+    namespace futex
+    {
+        /**
+         * @brief Sleeps while *word == expected, at most `timeout` if given.
+         *        Spurious wake-ups are possible; callers re-check.
+         *
+         * @param word
+         * @param expected
+         * @param timeout Relative, nullptr to wait indefinitely.
+         */
+        inline void Wait(std::atomic<std::uint32_t>& word, std::uint32_t expected, const timespec* timeout) noexcept
+        {
+            syscall(SYS_futex, reinterpret_cast<std::uint32_t*>(&word), FUTEX_WAIT_PRIVATE, expected, timeout, nullptr, 0);
+        }
+
+        /**
+         * @brief Wakes up to `count` threads sleeping on word.
+         *
+         * @param word
+         * @param count
+         */
+        inline void Wake(std::atomic<std::uint32_t>& word, int count) noexcept
+        {
+            syscall(SYS_futex, reinterpret_cast<std::uint32_t*>(&word), FUTEX_WAKE_PRIVATE, count, nullptr, nullptr, 0);
+        }
+    }
+
+    /**
+     * @brief Bounded pool for back-pressure: Allocate() throws when the pool
+     *        is exhausted like MemoryAllocator, while AllocateWait() and
+     *        AllocateFor() park the caller on a futex until a block is freed.
+     *        Free() only makes a syscall when somebody is parked.
+     *
+     * @tparam block_size
+     * @tparam blocks
+     */
+    template <size_t block_size, size_t blocks>
+    class BlockingMemoryAllocator
+    {
+        // underlying single-threaded pool
+        MemoryAllocator<block_size, blocks> pool_;
+        SpinLock lock_;
+        // bumped by every Free(), the futex word waiters sleep on
+        std::atomic<std::uint32_t> frees_;
+        // number of parked threads
+        std::atomic<std::uint32_t> waiters_;
+
+    public:
+
+        /**
+         * @brief Construct a new Blocking Memory Allocator object.
+         *
+         */
+        BlockingMemoryAllocator() : pool_(), lock_(), frees_(0), waiters_(0) {}
+
+        /**
+         * @brief Allocates memory, throwing if the pool is exhausted.
+         *
+         * @return void*
+         */
+        void* Allocate()
+        {
+            std::lock_guard<SpinLock> guard(lock_);
+            return pool_.Allocate();
+        }
+
+        /**
+         * @brief Allocates memory, waiting as long as needed for a block.
+         *
+         * @return void*
+         */
+        void* AllocateWait()
+        {
+            for (;;)
+            {
+                const std::uint32_t seen = frees_.load(std::memory_order_seq_cst);
+
+                if (void* block = try_allocate()) return block;
+
+                park(seen, nullptr);
+            }
+        }
+
+        /**
+         * @brief Allocates memory, waiting up to `timeout` for a block.
+         *
+         * @tparam Rep
+         * @tparam Period
+         * @param timeout
+         * @return void* nullptr if the timeout expired.
+         */
+        template <typename Rep, typename Period>
+        void* AllocateFor(const std::chrono::duration<Rep, Period>& timeout)
+        {
+            using clock = std::chrono::steady_clock;
+
+            const clock::time_point deadline = clock::now() + std::chrono::duration_cast<clock::duration>(timeout);
+
+            for (;;)
+            {
+                const std::uint32_t seen = frees_.load(std::memory_order_seq_cst);
+
+                if (void* block = try_allocate()) return block;
+
+                const clock::duration left = deadline - clock::now();
+
+                if (left <= clock::duration::zero()) return nullptr;
+
+                const auto secs = std::chrono::duration_cast<std::chrono::seconds>(left);
+                const auto nsecs = std::chrono::duration_cast<std::chrono::nanoseconds>(left - secs);
+
+                timespec relative = {};
+                relative.tv_sec = static_cast<time_t>(secs.count());
+                relative.tv_nsec = static_cast<long>(nsecs.count());
+
+                park(seen, &relative);
+            }
+        }
+
+        /**
+         * @brief Frees memory, waking one waiter if there are any.
+         *
+         * @param block
+         */
+        void Free(void* block) noexcept
+        {
+            {
+                std::lock_guard<SpinLock> guard(lock_);
+                pool_.Free(block);
+            }
+
+            // a waiter that missed this block will see the counter move
+            frees_.fetch_add(1, std::memory_order_seq_cst);
+
+            if (waiters_.load(std::memory_order_seq_cst))
+                futex::Wake(frees_, 1);
+        }
+
+        /**
+         * @brief Whether or not there is room for more allocations.
+         *
+         * @return true
+         * @return false
+         */
+        bool CanAllocate() noexcept
+        {
+            std::lock_guard<SpinLock> guard(lock_);
+            return pool_.CanAllocate();
+        }
+
+        // prevent copying of any kind
+        BlockingMemoryAllocator& operator=(BlockingMemoryAllocator& rhs) = delete;
+        BlockingMemoryAllocator(const BlockingMemoryAllocator& rhs) = delete;
+        BlockingMemoryAllocator(BlockingMemoryAllocator&& rhs) = delete;
+
+    private:
+
+        /**
+         * @brief Allocates if a block is available.
+         *
+         * @return void* nullptr if the pool is exhausted.
+         */
+        void* try_allocate()
+        {
+            std::lock_guard<SpinLock> guard(lock_);
+            return pool_.CanAllocate() ? pool_.Allocate() : nullptr;
+        }
+
+        /**
+         * @brief Sleeps until the free counter moves away from `seen`.
+         *
+         * @param seen
+         * @param timeout
+         */
+        void park(std::uint32_t seen, const timespec* timeout) noexcept
+        {
+            waiters_.fetch_add(1, std::memory_order_seq_cst);
+            futex::Wait(frees_, seen, timeout);
+            waiters_.fetch_sub(1, std::memory_order_seq_cst);
+        }
+    };
+}
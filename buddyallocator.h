@@ -0,0 +1,276 @@
+/******************************************************************************/
+/*
+* @file   buddyallocator.h
+* @author Aditya Harsh
+* @brief  Power-of-two buddy allocator for variable-size blocks.
+*/
+/******************************************************************************/
+
+#pragma once
+
+#include "osmemory.h" /* ATL::HeapStorage */
+
+#include <cstddef>   /* std::size_t        */
+#include <cstdlib>   /* std::abort         */
+#include <memory>    /* std::unique_ptr    */
+#include <stdexcept> /* std::runtime_error */
+
+namespace ATL
+{
+    /**
+     * @brief Buddy allocator over one arena of 2^max_order bytes, serving
+     *        blocks of 2^min_order to 2^max_order bytes. Requests are rounded
+     *        up to a power of two; larger free blocks are split in halves
+     *        ("buddies") on the way down and merged back on free. Each order
+     *        has its own free list and a bitmap holds one bit per buddy pair
+     *        (set when exactly one of the two is free), so both Allocate()
+     *        and Free() are O(max_order - min_order).
+     *
+     * @tparam min_order Log2 of the smallest block, at least 4.
+     * @tparam max_order Log2 of the arena size.
+     * @tparam Storage HeapStorage, MappedStorage or HugePageStorage
+     */
+    template <size_t min_order, size_t max_order, typename Storage = HeapStorage>
+    class BuddyAllocator
+    {
+        // safety checking
+        static_assert(min_order >= 4, "Blocks must be able to hold two pointers.");
+        static_assert(min_order <= max_order, "Smallest block cannot exceed the arena.");
+        static_assert(max_order < 48, "Arena too large.");
+        static_assert(max_order - min_order <= 24, "Too many orders, metadata would be huge.");
+
+        // internal memory type
+        using uchar = unsigned char;
+
+        // free block, doubly linked so a buddy can be unlinked in O(1)
+        struct Node
+        {
+            Node* prev;
+            Node* next;
+        };
+
+        static constexpr size_t orders = max_order - min_order + 1;
+        static constexpr size_t arena_size = size_t(1) << max_order;
+        static constexpr size_t min_blocks = size_t(1) << (max_order - min_order);
+        static constexpr size_t pair_words = (min_blocks + 63) / 64;
+
+        // arena
+        uchar* data_;
+        // free list per order, smallest first
+        Node* free_[orders];
+        // order of every allocated block, by its first min-block; 0 = none
+        std::unique_ptr<uchar[]> order_of_;
+        // one bit per buddy pair, every order packed back to back
+        std::unique_ptr<unsigned long long[]> pairs_;
+
+    public:
+
+        /**
+         * @brief Construct a new Buddy Allocator object. The whole arena
+         *        starts out as one free block.
+         *
+         */
+        BuddyAllocator() : data_(nullptr), free_(), order_of_(new uchar[min_blocks]()),
+                           pairs_(new unsigned long long[pair_words]())
+        {
+            data_ = static_cast<uchar*>(Storage::Acquire(arena_size));
+            push_list(data_, max_order);
+        }
+
+        /**
+         * @brief Destructor
+         *
+         */
+        ~BuddyAllocator() noexcept
+        {
+            Storage::Release(data_, arena_size);
+        }
+
+        /**
+         * @brief Allocates a block of at least `size` bytes.
+         *
+         * @param size
+         * @return void*
+         */
+        void* Allocate(size_t size)
+        {
+            const size_t order = OrderFor(size);
+
+            // smallest order that has something free
+            size_t k = order;
+            while (k <= max_order && !free_[k - min_order]) ++k;
+
+            if (k > max_order) throw std::runtime_error("Out of blocks.");
+
+            uchar* block = reinterpret_cast<uchar*>(free_[k - min_order]);
+            pop_list(block, k);
+            toggle_pair(block, k);
+
+            // split, keeping the lower half and freeing the upper one
+            while (k > order)
+            {
+                --k;
+                push_list(block + (size_t(1) << k), k);
+                toggle_pair(block, k);
+            }
+
+            order_of_[index_of(block)] = static_cast<uchar>(order);
+
+            return block;
+        }
+
+        /**
+         * @brief Frees a block, merging it with its buddy for as long as the
+         *        buddy is free too.
+         *
+         * @param block
+         */
+        void Free(void* block) noexcept
+        {
+            // safety check
+            if (!Owns(block) || (static_cast<uchar*>(block) - data_) % (size_t(1) << min_order)) std::abort();
+
+            uchar* mem = static_cast<uchar*>(block);
+            size_t k = order_of_[index_of(mem)];
+
+            // double frees and pointers into the middle of larger blocks
+            if (!k) std::abort();
+
+            order_of_[index_of(mem)] = 0;
+
+            for (; k < max_order; ++k)
+            {
+                // bit clear afterwards means the buddy is free as well
+                if (toggle_pair(mem, k)) break;
+
+                uchar* buddy = data_ + (static_cast<size_t>(mem - data_) ^ (size_t(1) << k));
+                pop_list(buddy, k);
+
+                if (buddy < mem) mem = buddy;
+            }
+
+            push_list(mem, k);
+        }
+
+        /**
+         * @brief Order of the block Allocate(size) hands out.
+         *
+         * @param size
+         * @return size_t
+         */
+        static size_t OrderFor(size_t size) noexcept
+        {
+            size_t order = min_order;
+            while (order <= max_order && (size_t(1) << order) < size) ++order;
+            return order;
+        }
+
+        /**
+         * @brief Largest request the arena can ever serve.
+         *
+         * @return size_t
+         */
+        static constexpr size_t Capacity() noexcept
+        {
+            return arena_size;
+        }
+
+        /**
+         * @brief Whether a pointer lies inside this allocator's arena.
+         *
+         * @param block
+         * @return true
+         * @return false
+         */
+        bool Owns(const void* block) const noexcept
+        {
+            const uchar* memory = static_cast<const uchar*>(block);
+            return memory >= data_ && memory < data_ + arena_size;
+        }
+
+        /**
+         * @brief Whether Allocate(size) would succeed right now.
+         *
+         * @param size
+         * @return true
+         * @return false
+         */
+        bool CanAllocate(size_t size) const noexcept
+        {
+            for (size_t k = OrderFor(size); k <= max_order; ++k)
+                if (free_[k - min_order]) return true;
+
+            return false;
+        }
+
+        // prevent copying of any kind
+        BuddyAllocator& operator=(BuddyAllocator& rhs) = delete;
+        BuddyAllocator(const BuddyAllocator& rhs) = delete;
+        BuddyAllocator(BuddyAllocator&& rhs) = delete;
+
+    private:
+
+        /**
+         * @brief Pushes a free block onto its order's list.
+         *
+         * @param block
+         * @param order
+         */
+        void push_list(uchar* block, size_t order) noexcept
+        {
+            Node* node = reinterpret_cast<Node*>(block);
+            Node*& head = free_[order - min_order];
+
+            node->prev = nullptr;
+            node->next = head;
+            if (head) head->prev = node;
+            head = node;
+        }
+
+        /**
+         * @brief Unlinks a free block from its order's list.
+         *
+         * @param block
+         * @param order
+         */
+        void pop_list(uchar* block, size_t order) noexcept
+        {
+            Node* node = reinterpret_cast<Node*>(block);
+
+            if (node->prev) node->prev->next = node->next;
+            else free_[order - min_order] = node->next;
+
+            if (node->next) node->next->prev = node->prev;
+        }
+
+        /**
+         * @brief Flips the bit of the pair a block belongs to at an order.
+         *
+         * @param block
+         * @param order Below max_order.
+         * @return true The bit is now set.
+         * @return false
+         */
+        bool toggle_pair(const uchar* block, size_t order) noexcept
+        {
+            if (order == max_order) return false;
+
+            // pairs of all smaller orders come first
+            const size_t bit = min_blocks - (size_t(1) << (max_order - order)) + (static_cast<size_t>(block - data_) >> (order + 1));
+
+            pairs_[bit / 64] ^= 1ull << (bit % 64);
+            return pairs_[bit / 64] & (1ull << (bit % 64));
+        }
+
+        /**
+         * @brief Index of the smallest block starting at an address.
+         *
+         * @param block
+         * @return size_t
+         */
+        size_t index_of(const uchar* block) const noexcept
+        {
+            return static_cast<size_t>(block - data_) >> min_order;
+        }
+    };
+}
@@ -0,0 +1,309 @@
+/******************************************************************************/
+/*
+* @file   compactingpool.h
+* @author Aditya Harsh
+* @brief  Handle-based pool that can move objects to give memory back.
+*/
+/******************************************************************************/
+
+#pragma once
+
+#include "memoryallocator.h" /* ATL::MemoryAllocator */
+
+#include <algorithm>   /* std::sort          */
+#include <cstddef>     /* std::max_align_t   */
+#include <cstdlib>     /* std::abort         */
+#include <memory>      /* std::unique_ptr    */
+#include <new>         /* placement new      */
+#include <stdexcept>   /* std::runtime_error */
+#include <type_traits> /* std::is_same       */
+#include <utility>     /* std::move          */
+
+namespace ATL
+{
+    /**
+     * @brief Default relocation: move constructs the object at its new
+     *        address. The old object is destroyed afterwards.
+     *
+     * @tparam T
+     */
+    template <typename T>
+    struct MoveRelocate
+    {
+        void operator()(T& from, void* to) const
+        {
+            new(to) T(std::move(from));
+        }
+    };
+
+    /**
+     * @brief Pool whose objects are reached through handles instead of raw
+     *        pointers, which lets Compact() move them. Objects live in chunks
+     *        of `chunk_blocks` slots that are created on demand. After churn
+     *        leaves many chunks sparsely used, Compact() moves the survivors
+     *        into the densest chunks and frees the emptied ones, so the
+     *        footprint shrinks back to the live set.
+     *
+     *        Pointers from Get() are only valid until the next Compact().
+     *
+     * @tparam T
+     * @tparam chunk_blocks Slots per chunk.
+     * @tparam max_chunks
+     * @tparam Relocate Callable invoked as relocate(T& from, void* to); it
+     *         must construct the object at `to`, leaving `from` destructible.
+     */
+    template <typename T, size_t chunk_blocks, size_t max_chunks, typename Relocate = MoveRelocate<T>>
+    class CompactingPool
+    {
+        static_assert(!std::is_same<T, void>::value, "Cannot allocate type void.");
+        static_assert(alignof(T) <= alignof(std::max_align_t), "Over-aligned types are not supported.");
+        static_assert(max_chunks >= 1, "At least 1 chunk must be allowed.");
+
+    public:
+
+        // index into the handle table, stable across compactions
+        using Handle = size_t;
+
+    private:
+
+        static constexpr size_t capacity = chunk_blocks * max_chunks;
+
+        // handle table entry, chained through `chunk` while unused
+        struct Entry
+        {
+            T* object = nullptr;
+            size_t chunk = 0;
+        };
+
+        // slots plus the handle living in each of them
+        struct Chunk
+        {
+            MemoryAllocator<sizeof(T), chunk_blocks> pool;
+            Handle owners[chunk_blocks];
+            size_t live;
+
+            Chunk() : pool(), owners(), live(0) {}
+        };
+
+        std::unique_ptr<Chunk> chunks_[max_chunks];
+        std::unique_ptr<Entry[]> table_;
+        size_t free_handle_;
+        size_t size_;
+        Relocate relocate_;
+
+    public:
+
+        /**
+         * @brief Construct a new Compacting Pool object. No chunk is created
+         *        until the first allocation.
+         *
+         * @param relocate
+         */
+        explicit CompactingPool(Relocate relocate = Relocate()) : chunks_(), table_(new Entry[capacity]), free_handle_(0),
+                                                                   size_(0), relocate_(relocate)
+        {
+            for (size_t i = 0; i < capacity; ++i)
+                table_[i].chunk = i + 1;
+        }
+
+        /**
+         * @brief Destroys every object still in the pool.
+         *
+         */
+        ~CompactingPool() noexcept
+        {
+            for (auto& chunk : chunks_)
+            {
+                if (!chunk) continue;
+
+                chunk->pool.ForEachAllocated([&chunk](void* block) {
+                    static_cast<T*>(block)->~T();
+                    chunk->pool.Free(block);
+                });
+            }
+        }
+
+        /**
+         * @brief Constructs an object in the first chunk with room.
+         *
+         * @tparam Args
+         * @param args
+         * @return Handle
+         */
+        template <typename... Args>
+        Handle Allocate(Args&&... args)
+        {
+            if (free_handle_ == capacity) throw std::runtime_error("Out of blocks.");
+
+            const size_t c = chunk_with_room();
+            Chunk& chunk = *chunks_[c];
+            void* mem = chunk.pool.Allocate();
+
+            try
+            {
+                new(mem) T(std::forward<Args>(args)...);
+            }
+            catch (...)
+            {
+                chunk.pool.Free(mem);
+                throw;
+            }
+
+            const Handle handle = free_handle_;
+            free_handle_ = table_[handle].chunk;
+
+            table_[handle] = Entry{static_cast<T*>(mem), c};
+            chunk.owners[chunk.pool.SlotIndex(mem)] = handle;
+            ++chunk.live;
+            ++size_;
+
+            return handle;
+        }
+
+        /**
+         * @brief Destroys an object and recycles its handle.
+         *
+         * @param handle
+         */
+        void Free(Handle handle) noexcept
+        {
+            // safety check
+            if (handle >= capacity || !table_[handle].object) std::abort();
+
+            Entry& entry = table_[handle];
+            Chunk& chunk = *chunks_[entry.chunk];
+
+            entry.object->~T();
+            chunk.pool.Free(entry.object);
+            --chunk.live;
+            --size_;
+
+            entry.object = nullptr;
+            entry.chunk = free_handle_;
+            free_handle_ = handle;
+        }
+
+        /**
+         * @brief Current address of an object.
+         *
+         * @param handle
+         * @return T&
+         */
+        T& Get(Handle handle) const noexcept
+        {
+            return *table_[handle].object;
+        }
+
+        /**
+         * @brief Moves live objects out of the sparsest chunks into the
+         *        densest ones until the live set occupies as few chunks as
+         *        possible, then frees the emptied chunks.
+         *
+         * @return size_t Number of chunks released.
+         */
+        size_t Compact()
+        {
+            size_t order[max_chunks];
+            size_t count = 0;
+
+            for (size_t c = 0; c < max_chunks; ++c)
+                if (chunks_[c]) order[count++] = c;
+
+            // densest first, those are the ones worth keeping
+            std::sort(order, order + count, [this](size_t a, size_t b) { return chunks_[a]->live > chunks_[b]->live; });
+
+            const size_t keep = (size_ + chunk_blocks - 1) / chunk_blocks;
+            size_t target = 0;
+
+            for (size_t i = keep; i < count; ++i)
+            {
+                const size_t source = order[i];
+                Chunk& from = *chunks_[source];
+
+                from.pool.ForEachAllocated([&](void* block) {
+                    while (chunks_[order[target]]->live == chunk_blocks) ++target;
+
+                    Chunk& to = *chunks_[order[target]];
+                    void* mem = to.pool.Allocate();
+                    T* object = static_cast<T*>(block);
+
+                    try
+                    {
+                        relocate_(*object, mem);
+                    }
+                    catch (...)
+                    {
+                        to.pool.Free(mem);
+                        throw;
+                    }
+
+                    const Handle handle = from.owners[from.pool.SlotIndex(block)];
+
+                    table_[handle] = Entry{static_cast<T*>(mem), order[target]};
+                    to.owners[to.pool.SlotIndex(mem)] = handle;
+                    ++to.live;
+
+                    object->~T();
+                    from.pool.Free(block);
+                    --from.live;
+                });
+
+                chunks_[source].reset();
+            }
+
+            return count > keep ? count - keep : 0;
+        }
+
+        /**
+         * @brief Number of live objects.
+         *
+         * @return size_t
+         */
+        size_t Size() const noexcept
+        {
+            return size_;
+        }
+
+        /**
+         * @brief Number of chunks currently holding memory.
+         *
+         * @return size_t
+         */
+        size_t ChunkCount() const noexcept
+        {
+            size_t count = 0;
+
+            for (const auto& chunk : chunks_)
+                count += chunk != nullptr;
+
+            return count;
+        }
+
+        // prevent copying of any kind
+        CompactingPool& operator=(CompactingPool& rhs) = delete;
+        CompactingPool(const CompactingPool& rhs) = delete;
+        CompactingPool(CompactingPool&& rhs) = delete;
+
+    private:
+
+        /**
+         * @brief Index of the first chunk with a free slot, creating one if
+         *        every existing chunk is full.
+         *
+         * @return size_t
+         */
+        size_t chunk_with_room()
+        {
+            size_t empty = max_chunks;
+
+            for (size_t c = 0; c < max_chunks; ++c)
+            {
+                if (chunks_[c] && chunks_[c]->live < chunk_blocks) return c;
+                if (!chunks_[c] && empty == max_chunks) empty = c;
+            }
+
+            chunks_[empty].reset(new Chunk());
+            return empty;
+        }
+    };
+}
@@ -0,0 +1,238 @@
+/******************************************************************************/
+/*
+* @file   coroutineallocator.h
+* @author Aditya Harsh
+* @brief  Pooled allocation of C++20 coroutine frames.
+*/
+/******************************************************************************/
+
+#pragma once
+
+#include "shardedallocator.h" /* ATL::ShardedMemoryAllocator */
+
+#include <cstddef> /* std::size_t */
+#include <new>     /* ::operator new, ::operator delete */
+
+namespace ATL
+{
+    /**
+     * @brief Size-classed pools for coroutine frames. Frames of up to 64,
+     *        128, 256, 512 and 1024 bytes come from one pool per class; bigger
+     *        frames, and any frame requested while its class is exhausted, go
+     *        to the global heap. Pools are thread-safe because a coroutine may
+     *        be destroyed on a different thread than the one that created it,
+     *        and each thread keeps a few freed frames per class so the common
+     *        create/destroy cycle never touches a lock.
+     *
+     * @tparam blocks_per_class
+     * @tparam shards Striped free lists per class.
+     * @tparam cached_per_class Frames each thread keeps per class.
+     */
+    template <size_t blocks_per_class = 1024, size_t shards = 8, size_t cached_per_class = 16>
+    class CoroutineFramePools
+    {
+        // size classes are 64 << i
+        static constexpr size_t classes = 5;
+        static constexpr size_t min_shift = 6;
+
+        template <size_t size_class>
+        using Pool = ShardedMemoryAllocator<(size_t(1) << (min_shift + size_class)), blocks_per_class, shards>;
+
+        // frames freed by this thread, handed back to the pools on exit
+        struct ThreadCache
+        {
+            void* frames[classes][cached_per_class] = {};
+            size_t counts[classes] = {};
+
+            ~ThreadCache()
+            {
+                for (size_t c = 0; c < classes; ++c)
+                    while (counts[c])
+                        release(c, frames[c][--counts[c]]);
+            }
+        };
+
+    public:
+
+        // largest frame served from a pool
+        static constexpr size_t max_frame = size_t(1) << (min_shift + classes - 1);
+
+        /**
+         * @brief Allocates memory for a frame of `size` bytes.
+         *
+         * @param size
+         * @return void*
+         */
+        static void* Allocate(size_t size)
+        {
+            const size_t size_class = class_of(size);
+
+            if (size_class == classes) return ::operator new(size);
+
+            ThreadCache& cache = thread_cache();
+
+            if (cache.counts[size_class])
+                return cache.frames[size_class][--cache.counts[size_class]];
+
+            void* frame = try_allocate(size_class);
+
+            return frame ? frame : ::operator new(size);
+        }
+
+        /**
+         * @brief Frees a frame. `size` must be the size it was allocated with.
+         *
+         * @param frame
+         * @param size
+         */
+        static void Free(void* frame, size_t size) noexcept
+        {
+            const size_t size_class = class_of(size);
+
+            if (size_class == classes || !owns(size_class, frame))
+                return ::operator delete(frame);
+
+            ThreadCache& cache = thread_cache();
+
+            if (cache.counts[size_class] < cached_per_class)
+                cache.frames[size_class][cache.counts[size_class]++] = frame;
+            else
+                release(size_class, frame);
+        }
+
+    private:
+
+        /**
+         * @brief Size class of a frame, `classes` if it is too big for pooling.
+         *
+         * @param size
+         * @return size_t
+         */
+        static constexpr size_t class_of(size_t size) noexcept
+        {
+            size_t size_class = 0;
+
+            while (size_class < classes && size > (size_t(1) << (min_shift + size_class)))
+                ++size_class;
+
+            return size_class;
+        }
+
+        /**
+         * @brief The calling thread's cache.
+         *
+         * @return ThreadCache&
+         */
+        static ThreadCache& thread_cache() noexcept
+        {
+            thread_local ThreadCache cache;
+            return cache;
+        }
+
+        /**
+         * @brief Pool of a size class, created on first use and never
+         *        destroyed: thread caches flush into it at thread exit, and
+         *        frames may be freed from static destructors, both of which
+         *        can run after function-local statics are gone.
+         *
+         * @tparam size_class
+         * @return Pool<size_class>&
+         */
+        template <size_t size_class>
+        static Pool<size_class>& pool()
+        {
+            static Pool<size_class>& instance = *new Pool<size_class>;
+            return instance;
+        }
+
+        /**
+         * @brief Takes a frame from a class's pool.
+         *
+         * @param size_class
+         * @return void* nullptr if the pool is exhausted.
+         */
+        static void* try_allocate(size_t size_class)
+        {
+            switch (size_class)
+            {
+                case 0: return pool<0>().TryAllocate();
+                case 1: return pool<1>().TryAllocate();
+                case 2: return pool<2>().TryAllocate();
+                case 3: return pool<3>().TryAllocate();
+                default: return pool<4>().TryAllocate();
+            }
+        }
+
+        /**
+         * @brief Whether a frame came from a class's pool.
+         *
+         * @param size_class
+         * @param frame
+         * @return true
+         * @return false
+         */
+        static bool owns(size_t size_class, const void* frame) noexcept
+        {
+            switch (size_class)
+            {
+                case 0: return pool<0>().Owns(frame);
+                case 1: return pool<1>().Owns(frame);
+                case 2: return pool<2>().Owns(frame);
+                case 3: return pool<3>().Owns(frame);
+                default: return pool<4>().Owns(frame);
+            }
+        }
+
+        /**
+         * @brief Returns a frame to its class's pool.
+         *
+         * @param size_class
+         * @param frame
+         */
+        static void release(size_t size_class, void* frame) noexcept
+        {
+            switch (size_class)
+            {
+                case 0: return pool<0>().Free(frame);
+                case 1: return pool<1>().Free(frame);
+                case 2: return pool<2>().Free(frame);
+                case 3: return pool<3>().Free(frame);
+                default: return pool<4>().Free(frame);
+            }
+        }
+    };
+
+    /**
+     * @brief Mixin for a coroutine promise_type that routes frame allocation
+     *        through CoroutineFramePools:
+     *
+     *            struct promise_type : ATL::PooledPromise<> { ... };
+     *
+     * @tparam Pools
+     */
+    template <typename Pools = CoroutineFramePools<>>
+    struct PooledPromise
+    {
+        /**
+         * @brief Allocates the coroutine frame.
+         *
+         * @param size
+         * @return void*
+         */
+        static void* operator new(std::size_t size)
+        {
+            return Pools::Allocate(size);
+        }
+
+        /**
+         * @brief Frees the coroutine frame.
+         *
+         * @param frame
+         * @param size
+         */
+        static void operator delete(void* frame, std::size_t size) noexcept
+        {
+            Pools::Free(frame, size);
+        }
+    };
+}
@@ -0,0 +1,207 @@
+/******************************************************************************/
+/*
+* @file   guardedallocator.h
+* @author Aditya Harsh
+* @brief  Hardened fixed-size allocator with a guard page behind every block.
+*/
+/******************************************************************************/
+
+#pragma once
+
+#include "osmemory.h" /* ATL::MapPages, ATL::ProtectPages */
+
+#include <cstddef>   /* std::max_align_t   */
+#include <cstdlib>   /* std::abort         */
+#include <memory>    /* std::unique_ptr    */
+#include <stdexcept> /* std::runtime_error */
+
+namespace ATL
+{
+    /**
+     * @brief Fixed-size allocator where every block sits in its own run of
+     *        pages, followed by a PROT_NONE guard page. Blocks are pushed
+     *        against the end of their pages, so writing past a block faults
+     *        immediately instead of corrupting the next slot. Bookkeeping
+     *        lives in side arrays outside the mapping, so an overrun has
+     *        nothing to overwrite. Costs at least two pages per block; meant
+     *        for large blocks and canary deployments.
+     *
+     *        Every guard page splits the mapping, so each block uses two of
+     *        the process's memory mappings. With Linux's default
+     *        vm.max_map_count (65530) that caps an instance at roughly 32k
+     *        blocks, less whatever else is mapped; past it construction
+     *        throws a runtime_error naming the limit.
+     *
+     *        Overrun detection is byte exact when block_size is a multiple of
+     *        alignof(std::max_align_t); otherwise the last few bytes of
+     *        alignment padding are still writable.
+     *
+     * @tparam block_size
+     * @tparam blocks
+     */
+    template <size_t block_size, size_t blocks>
+    class GuardedMemoryAllocator
+    {
+        // safety checking
+        static_assert(block_size >= 1, "Block size must be at least 1 byte.");
+        static_assert(blocks >= 1, "At least 1 block must be allocated.");
+
+        // internal memory type
+        using uchar = unsigned char;
+
+        // byte patterns to mark memory blocks
+        enum Pattern : uchar
+        {
+            UNALLOCATED = 0xAA,
+            ALLOCATED = 0xBB
+        };
+
+        // payloads keep fundamental alignment
+        static constexpr size_t align = alignof(std::max_align_t);
+        static constexpr size_t payload_size = (block_size + align - 1) / align * align;
+
+        // page-sized stride of one block + its guard page
+        size_t stride_;
+        // pages holding every block
+        uchar* data_;
+        // block states, kept away from the blocks
+        std::unique_ptr<uchar[]> state_;
+        // stack of free block indices
+        std::unique_ptr<size_t[]> free_;
+        size_t free_count_;
+
+    public:
+
+        /**
+         * @brief Maps the blocks and protects every guard page.
+         *
+         */
+        GuardedMemoryAllocator() : stride_(RoundToPages(payload_size) + PageSize()), data_(nullptr),
+                                   state_(new uchar[blocks]), free_(new size_t[blocks]), free_count_(blocks)
+        {
+            data_ = static_cast<uchar*>(MapPages(stride_ * blocks));
+
+            try
+            {
+                for (size_t i = 0; i < blocks; ++i)
+                    ProtectPages(data_ + (i + 1) * stride_ - PageSize(), PageSize());
+            }
+            catch (...)
+            {
+                UnmapPages(data_, stride_ * blocks);
+                throw;
+            }
+
+            // lowest addresses handed out first
+            for (size_t i = 0; i < blocks; ++i)
+            {
+                state_[i] = Pattern::UNALLOCATED;
+                free_[i] = blocks - 1 - i;
+            }
+        }
+
+        /**
+         * @brief Destructor
+         *
+         */
+        ~GuardedMemoryAllocator() noexcept
+        {
+            UnmapPages(data_, stride_ * blocks);
+        }
+
+        /**
+         * @brief Allocates memory with O(1) performance.
+         *
+         * @return void*
+         */
+        void* Allocate()
+        {
+            if (!free_count_) throw std::runtime_error("Out of blocks.");
+
+            const size_t index = free_[--free_count_];
+
+            // safety check
+            if (state_[index] != Pattern::UNALLOCATED)
+                throw std::runtime_error("Corrupted block detected!");
+
+            state_[index] = Pattern::ALLOCATED;
+
+            return block_of(index);
+        }
+
+        /**
+         * @brief Frees memory. Foreign, interior and double frees abort.
+         *
+         * @param block
+         */
+        void Free(void* block) noexcept
+        {
+            if (!Owns(block)) std::abort();
+
+            const size_t index = static_cast<size_t>(static_cast<uchar*>(block) - data_) / stride_;
+
+            // safety check
+            if (state_[index] != Pattern::ALLOCATED)
+                std::abort();
+
+            state_[index] = Pattern::UNALLOCATED;
+            free_[free_count_++] = index;
+        }
+
+        /**
+         * @brief Usable bytes per block.
+         *
+         * @return size_t
+         */
+        static constexpr size_t BlockSize() noexcept
+        {
+            return block_size;
+        }
+
+        /**
+         * @brief Whether a pointer is the start of a block in this
+         *        allocator's mapping. Interior pointers are rejected.
+         *
+         * @param block
+         * @return true
+         * @return false
+         */
+        bool Owns(const void* block) const noexcept
+        {
+            const uchar* memory = static_cast<const uchar*>(block);
+
+            if (memory < data_ || memory >= data_ + stride_ * blocks) return false;
+
+            return memory == block_of(static_cast<size_t>(memory - data_) / stride_);
+        }
+
+        /**
+         * @brief Whether or not there is room for more allocations.
+         *
+         * @return true
+         * @return false
+         */
+        bool CanAllocate() const noexcept
+        {
+            return free_count_;
+        }
+
+        // prevent copying of any kind
+        GuardedMemoryAllocator& operator=(GuardedMemoryAllocator& rhs) = delete;
+        GuardedMemoryAllocator(const GuardedMemoryAllocator& rhs) = delete;
+        GuardedMemoryAllocator(GuardedMemoryAllocator&& rhs) = delete;
+
+    private:
+
+        /**
+         * @brief Payload of a block, ending right at its guard page.
+         *
+         * @param index
+         * @return uchar*
+         */
+        uchar* block_of(size_t index) const noexcept
+        {
+            return data_ + (index + 1) * stride_ - PageSize() - payload_size;
+        }
+    };
+}
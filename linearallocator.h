@@ -0,0 +1,287 @@
+/******************************************************************************/
+/*
+* @file   linearallocator.h
+* @author Aditya Harsh
+* @brief  Monotonic bump allocator with LIFO rewind markers, and a
+*         multi-buffered arena built from several of them.
+*/
+/******************************************************************************/
+
+#pragma once
+
+#include "memoryallocator.h" /* ATL::MemoryAllocator */
+
+#include <cstddef>   /* std::max_align_t   */
+#include <cstdint>   /* std::uintptr_t     */
+#include <new>       /* placement new      */
+#include <stdexcept> /* std::runtime_error */
+
+namespace ATL
+{
+    /**
+     * @brief Bump allocator for scratch memory. Allocate() only advances an
+     *        offset inside the current chunk; when it runs out, the next chunk
+     *        is taken from a MemoryAllocator of `chunk_size` blocks. Nothing
+     *        is freed individually: GetMarker() remembers a position and
+     *        RewindTo() releases everything allocated after it in O(1).
+     *        Chunks are kept when rewinding, so a steady workload stops
+     *        touching the pool after warming up. Destructors of objects
+     *        placed here are never run.
+     *
+     * @tparam chunk_size Bytes per chunk, including a small header.
+     * @tparam chunks Most chunks that can be in use at once.
+     */
+    template <size_t chunk_size, size_t chunks>
+    class LinearAllocator
+    {
+        // internal memory type
+        using uchar = unsigned char;
+
+        // start of every chunk, linking them in allocation order
+        struct Chunk
+        {
+            Chunk* next;
+        };
+
+        static constexpr size_t align = alignof(std::max_align_t);
+        static constexpr size_t header_size = (sizeof(Chunk) + align - 1) / align * align;
+        static constexpr size_t usable = chunk_size - header_size;
+
+        // safety checking
+        static_assert(chunk_size > header_size, "Chunks are too small to hold anything.");
+
+    public:
+
+        // position to rewind to
+        struct Marker
+        {
+            Chunk* chunk;
+            size_t offset;
+        };
+
+    private:
+
+        // chunk storage
+        MemoryAllocator<chunk_size, chunks> pool_;
+        // every chunk taken so far, in order
+        Chunk* first_;
+        // chunk being bumped into, nullptr before the first allocation
+        Chunk* current_;
+        size_t offset_;
+
+    public:
+
+        /**
+         * @brief Construct a new Linear Allocator object. No chunk is taken
+         *        until the first allocation.
+         *
+         */
+        LinearAllocator() : pool_(), first_(nullptr), current_(nullptr), offset_(0) {}
+
+        /**
+         * @brief Destructor
+         *
+         */
+        ~LinearAllocator() noexcept
+        {
+            while (first_)
+            {
+                Chunk* next = first_->next;
+                pool_.Free(first_);
+                first_ = next;
+            }
+        }
+
+        /**
+         * @brief Bumps out `size` bytes aligned to `alignment`.
+         *
+         * @param size
+         * @param alignment A power of two.
+         * @return void*
+         */
+        void* Allocate(size_t size, size_t alignment = alignof(std::max_align_t))
+        {
+            if (current_)
+                if (void* block = bump(size, alignment))
+                    return block;
+
+            if (size > usable) throw std::runtime_error("Allocation does not fit in a chunk.");
+
+            next_chunk();
+
+            void* block = bump(size, alignment);
+            if (!block) throw std::runtime_error("Allocation does not fit in a chunk.");
+
+            return block;
+        }
+
+        /**
+         * @brief Current position.
+         *
+         * @return Marker
+         */
+        Marker GetMarker() const noexcept
+        {
+            return Marker{current_, offset_};
+        }
+
+        /**
+         * @brief Releases everything allocated since a marker was taken.
+         *        Markers taken after it become invalid.
+         *
+         * @param marker
+         */
+        void RewindTo(Marker marker) noexcept
+        {
+            current_ = marker.chunk;
+            offset_ = marker.offset;
+        }
+
+        /**
+         * @brief Releases everything, keeping the chunks for reuse.
+         *
+         */
+        void Reset() noexcept
+        {
+            current_ = nullptr;
+            offset_ = 0;
+        }
+
+        /**
+         * @brief Returns the chunks past the current position to the pool.
+         *
+         */
+        void Trim() noexcept
+        {
+            Chunk*& tail = current_ ? current_->next : first_;
+
+            while (tail)
+            {
+                Chunk* next = tail->next;
+                pool_.Free(tail);
+                tail = next;
+            }
+        }
+
+        /**
+         * @brief Largest single allocation a chunk can hold.
+         *
+         * @return size_t
+         */
+        static constexpr size_t ChunkCapacity() noexcept
+        {
+            return usable;
+        }
+
+        // prevent copying of any kind
+        LinearAllocator& operator=(LinearAllocator& rhs) = delete;
+        LinearAllocator(const LinearAllocator& rhs) = delete;
+        LinearAllocator(LinearAllocator&& rhs) = delete;
+
+    private:
+
+        /**
+         * @brief Tries to fit an allocation into the current chunk.
+         *
+         * @param size
+         * @param alignment
+         * @return void* nullptr when it does not fit.
+         */
+        void* bump(size_t size, size_t alignment) noexcept
+        {
+            uchar* base = reinterpret_cast<uchar*>(current_) + header_size;
+            const std::uintptr_t at = reinterpret_cast<std::uintptr_t>(base) + offset_;
+            const size_t start = offset_ + (((at + alignment - 1) & ~(alignment - 1)) - at);
+
+            if (start > usable || size > usable - start) return nullptr;
+
+            offset_ = start + size;
+            return base + start;
+        }
+
+        /**
+         * @brief Moves on to the chunk after the current one, reusing a kept
+         *        chunk when there is one.
+         *
+         */
+        void next_chunk()
+        {
+            Chunk*& next = current_ ? current_->next : first_;
+
+            if (!next) next = new(pool_.Allocate()) Chunk{nullptr};
+
+            current_ = next;
+            offset_ = 0;
+        }
+    };
+
+    /**
+     * @brief N-buffered frame arena for pipelines where data made in one tick
+     *        is consumed in the following ones. Allocations go to the current
+     *        LinearAllocator; Flip() moves on to the next one, wiping the
+     *        buffer filled `buffers` ticks ago in O(1). Anything allocated in
+     *        a tick therefore stays valid for the next `buffers - 1` flips
+     *        with no per-object frees. The only synchronization needed is
+     *        ordering Flip() against the stages using the arena.
+     *
+     * @tparam chunk_size Bytes per chunk, including a small header.
+     * @tparam chunks Most chunks per buffer.
+     * @tparam buffers Ticks an allocation survives, counting its own.
+     */
+    template <size_t chunk_size, size_t chunks, size_t buffers = 2>
+    class DoubleBufferedArena
+    {
+        static_assert(buffers >= 2, "Need at least 2 buffers.");
+
+        // one bump arena per tick in flight
+        LinearAllocator<chunk_size, chunks> arenas_[buffers];
+        size_t current_;
+
+    public:
+
+        /**
+         * @brief Construct a new Double Buffered Arena object.
+         *
+         */
+        DoubleBufferedArena() : arenas_(), current_(0) {}
+
+        /**
+         * @brief Bumps out `size` bytes in the current tick's buffer.
+         *
+         * @param size
+         * @param alignment A power of two.
+         * @return void*
+         */
+        void* Allocate(size_t size, size_t alignment = alignof(std::max_align_t))
+        {
+            return arenas_[current_].Allocate(size, alignment);
+        }
+
+        /**
+         * @brief Starts a new tick, releasing everything allocated in the
+         *        oldest buffer. Its chunks are kept for reuse.
+         *
+         */
+        void Flip() noexcept
+        {
+            current_ = (current_ + 1) % buffers;
+            arenas_[current_].Reset();
+        }
+
+        /**
+         * @brief Buffer being allocated from, for markers and rewinds within
+         *        a tick.
+         *
+         * @return LinearAllocator<chunk_size, chunks>&
+         */
+        LinearAllocator<chunk_size, chunks>& Current() noexcept
+        {
+            return arenas_[current_];
+        }
+
+        // prevent copying of any kind
+        DoubleBufferedArena& operator=(DoubleBufferedArena& rhs) = delete;
+        DoubleBufferedArena(const DoubleBufferedArena& rhs) = delete;
+        DoubleBufferedArena(DoubleBufferedArena&& rhs) = delete;
+    };
+}
@@ -8,25 +8,151 @@
 
 #pragma once
 
-#include <cstring>   /* std::memset        */
-#include <stdexcept> /* std::runtime_error */
+#include <cstddef>     /* std::max_align_t   */
+#include <cstring>     /* std::memset        */
+#include <memory>      /* std::unique_ptr    */
+#include <new>         /* std::bad_alloc     */
+#include <cstdint>     /* std::uint16_t      */
+#include <stdexcept>   /* std::runtime_error */
+#include <type_traits> /* std::conditional_t */
+#include <utility>     /* std::forward       */
 
-// macros to make integration easier if making a static class allocator
-#define CREATE_CLASS_NEW(_alloc_name)                                               \
-void* operator new(std::size_t)                                                     \
-{                                                                                   \
-    void* mem = _alloc_name.MemoryAllocator::Allocate();                            \
-    if (!mem) throw std::runtime_error("Allocation failed.");                       \
-    return mem;                                                                     \
-}                                                                                   \
-
-#define CREATE_CLASS_DELETE(_alloc_name) void operator delete(void* ptr) noexcept {_alloc_name.MemoryAllocator::Free(ptr);}
-#define GEN_CLASS_NEW_DEL(_alloc_name) CREATE_CLASS_NEW(_alloc_name) CREATE_CLASS_DELETE(_alloc_name)
+#include "sanitizers.h" /* ATL::sanitizer */
 
 namespace ATL
 {
-    template <size_t block_size, size_t blocks>
-    class MemoryAllocator
+    /**
+     * @brief What Allocate() prefetches of the block that becomes the new
+     *        head of the free list.
+     * 
+     */
+    enum class Prefetch : unsigned char
+    {
+        NONE,
+        LINK,
+        LINK_AND_PAYLOAD
+    };
+
+    /**
+     * @brief Policy for production builds: only the guard bytes are checked,
+     *        and occupancy is read back from them rather than kept in a
+     *        bitmap. Derive from it and set track_occupancy to keep the
+     *        bitmap when ForEachAllocated or AllocateContiguous run often.
+     * 
+     */
+    struct ReleasePolicy
+    {
+        static constexpr bool debug = false;
+        static constexpr bool track_occupancy = false;
+        static constexpr size_t quarantine = 0;
+        static constexpr Prefetch prefetch = Prefetch::NONE;
+    };
+
+    /**
+     * @brief Policy for hunting memory bugs. Freed blocks wait in a FIFO
+     *        quarantine before they can be reused and are filled with a poison
+     *        byte that is verified when they are handed out again, catching
+     *        writes through stale pointers. An occupancy bitmap catches double
+     *        and foreign frees exactly.
+     * 
+     * @tparam quarantine_blocks Freed blocks held back from reuse.
+     * @tparam poison_byte 
+     */
+    template <size_t quarantine_blocks = 64, unsigned char poison_byte = 0xDD>
+    struct DebugPolicy
+    {
+        static constexpr bool debug = true;
+        static constexpr bool track_occupancy = true;
+        static constexpr size_t quarantine = quarantine_blocks;
+        static constexpr unsigned char poison = poison_byte;
+        static constexpr Prefetch prefetch = Prefetch::NONE;
+    };
+
+    /**
+     * @brief Adds prefetching to another policy. Once a block is handed out,
+     *        the next one on the free list is known, so its header (and
+     *        optionally its payload, for writing) is fetched while the caller
+     *        works, instead of missing at the start of the next Allocate().
+     *        Pays off when the free list is scattered, e.g. after frees in
+     *        random order, and blocks are allocated in bursts.
+     * 
+     *            ATL::MemoryAllocator<64, 4096, ATL::Prefetching<ATL::ReleasePolicy>> pool;
+     * 
+     * @tparam Policy ReleasePolicy or DebugPolicy
+     * @tparam mode 
+     */
+    template <typename Policy, Prefetch mode = Prefetch::LINK_AND_PAYLOAD>
+    struct Prefetching : Policy
+    {
+        static constexpr Prefetch prefetch = mode;
+    };
+
+    /**
+     * @brief Backing store from the global heap, the default for every
+     *        arena. MappedStorage and HugePageStorage (osmemory.h) map it
+     *        from the OS instead.
+     * 
+     */
+    struct HeapStorage
+    {
+        static void* Acquire(size_t bytes)
+        {
+            return ::operator new(bytes);
+        }
+
+        static void Release(void* mem, size_t) noexcept
+        {
+            ::operator delete(mem);
+        }
+    };
+
+    // pools are release pools unless a policy is chosen explicitly, or every
+    // default pool is switched to debug checks with -DATL_DEBUG_POOLS
+#ifdef ATL_DEBUG_POOLS
+    using DefaultPoolPolicy = DebugPolicy<>;
+#else
+    using DefaultPoolPolicy = ReleasePolicy;
+#endif
+
+    namespace detail
+    {
+        // quarantine ring position, empty (and free via EBO) in release builds
+        template <bool debug>
+        struct QuarantineState
+        {
+            size_t q_head = 0;
+            size_t q_count = 0;
+        };
+
+        template <>
+        struct QuarantineState<false> {};
+
+        // narrowest free-list link able to name every block: a 1-based slot
+        // index when it fits in 16 or 32 bits, a pointer otherwise. 0 is the
+        // only reserved value (end of list), so indices run up to the type's
+        // maximum and a 16-bit link covers exactly 0xFFFF blocks
+        template <size_t blocks>
+        using LinkType = std::conditional_t<(blocks <= 0xFFFFull), std::uint16_t,
+                         std::conditional_t<(blocks <= 0xFFFFFFFFull), std::uint32_t, void*>>;
+
+        // largest power of two not above n
+        constexpr size_t BitFloor(size_t n) noexcept
+        {
+            return n > 1 ? 2 * BitFloor(n / 2) : 1;
+        }
+    }
+
+    /**
+     * @brief Fixed-size allocator handing out `blocks` blocks of `block_size`
+     *        bytes from a single allocation.
+     * 
+     * @tparam block_size 
+     * @tparam blocks 
+     * @tparam Policy ReleasePolicy or DebugPolicy, optionally Prefetching
+     * @tparam Storage HeapStorage, MappedStorage or HugePageStorage
+     */
+    template <size_t block_size, size_t blocks, typename Policy = DefaultPoolPolicy, typename Storage = HeapStorage>
+    class MemoryAllocator : private detail::QuarantineState<Policy::debug>
     {
         // safety checking
         static_assert(block_size >= 1, "Block size must be at least 1 byte.");
@@ -44,26 +170,46 @@ namespace ATL
         enum Pattern : uchar
         {
             UNALLOCATED = 0xAA,
-            ALLOCATED = 0xBB
+            ALLOCATED = 0xBB,
+            // first block of an AllocateContiguous run
+            ALLOCATED_RUN = 0xBC
         };
     
     private:
 
+        // free-list link, sized by the number of blocks
+        using Link = detail::LinkType<blocks>;
+
         // represents a list object
         struct List
         {
-            List* next = nullptr;
+            Link next;
         };
 
         // internal memory block
         uchar* data_;
         // page of available blocks
         List* free_list_;
+        // occupancy bitmap, then the quarantine ring, when the policy keeps
+        // them; kept out of the arena so a block overrun cannot corrupt it
+        std::unique_ptr<unsigned long long[]> meta_;
 
-        // meta data
-        static constexpr size_t vp_size = sizeof(void*);
-        static constexpr size_t hb_size = vp_size + pad_bytes + block_size;
+        // meta data, header and stride are rounded so every block is
+        // suitably aligned for any type that fits in it: fundamental
+        // alignment, or less for blocks smaller than that
+        static constexpr size_t link_size = sizeof(Link);
+        static constexpr size_t align = block_size < alignof(std::max_align_t) ? detail::BitFloor(block_size) : alignof(std::max_align_t);
+        static constexpr size_t header_size = (link_size + pad_bytes + align - 1) / align * align;
+        static constexpr size_t hb_size = (header_size + block_size + align - 1) / align * align;
         static constexpr size_t bytes_allocated = hb_size * blocks;
+        // payload bytes prefetched ahead, at most a few cache lines
+        static constexpr size_t prefetch_bytes = block_size < 256 ? block_size : 256;
+
+        // occupancy bitmap and debug meta data, in words
+        static constexpr bool tracked = Policy::debug || Policy::track_occupancy;
+        static constexpr size_t bitmap_words = tracked ? (blocks + 63) / 64 : 0;
+        static constexpr size_t quarantine_slots = Policy::debug ? Policy::quarantine : 0;
+        static constexpr size_t meta_words = bitmap_words + (quarantine_slots * sizeof(List*) + sizeof(unsigned long long) - 1) / sizeof(unsigned long long);
         
     public:
             
@@ -71,17 +217,23 @@ namespace ATL
          * @brief Construct a new Memory Allocator object.
          * 
          */
-        MemoryAllocator() : data_(nullptr), free_list_(nullptr)
+        MemoryAllocator() : detail::QuarantineState<Policy::debug>(), data_(nullptr), free_list_(nullptr), meta_(meta_words ? new unsigned long long[meta_words]() : nullptr)
         {
-            data_ = new uchar[bytes_allocated];
+            data_ = static_cast<uchar*>(Storage::Acquire(bytes_allocated));
 
             std::memset(data_, 0, bytes_allocated);
 
             for (size_t i = 0; i < blocks; ++i)
             {
-                std::memset(data_ + vp_size + (i * hb_size), Pattern::UNALLOCATED, pad_bytes);
+                if constexpr (Policy::debug)
+                    std::memset(data_ + header_size + (i * hb_size), Policy::poison, block_size);
+
+                std::memset(data_ + header_size - pad_bytes + (i * hb_size), Pattern::UNALLOCATED, pad_bytes);
                 push_list(reinterpret_cast<List*>(data_ + (i * hb_size)));
             }
+
+            // no-op unless built with ASan or Valgrind
+            sanitizer::PoolCreate(data_, bytes_allocated);
         }
 
         /**
@@ -90,7 +242,8 @@ namespace ATL
          */
         ~MemoryAllocator() noexcept
         {
-            delete [] data_;
+            sanitizer::PoolDestroy(data_, bytes_allocated);
+            Storage::Release(data_, bytes_allocated);
         }
 
         /**
@@ -100,19 +253,51 @@ namespace ATL
          */
         void* Allocate()
         {
+            if constexpr (quarantine_slots != 0)
+                if (!free_list_ && this->q_count)
+                    release_quarantined();
+
             if (!free_list_) throw std::runtime_error("Out of blocks.");
 
-            uchar* memory = reinterpret_cast<uchar*>(free_list_) + vp_size;
+            uchar* slot = reinterpret_cast<uchar*>(free_list_);
+            uchar* memory = slot + header_size - pad_bytes;
+
+            sanitizer::Open(slot, header_size);
 
             // safety check
             for (size_t i = 0; i < pad_bytes; ++i)
                 if (memory[i] != Pattern::UNALLOCATED)
                     throw std::runtime_error("Corrupted block detected!");
 
+            if constexpr (Policy::debug)
+            {
+                sanitizer::Open(memory + pad_bytes, block_size);
+
+                // anything but poison means someone wrote to a freed block
+                for (size_t i = 0; i < block_size; ++i)
+                    if (memory[pad_bytes + i] != Policy::poison)
+                        throw std::runtime_error("Use after free detected!");
+            }
+
+            if constexpr (tracked)
+            {
+                const size_t index = SlotIndex(memory + pad_bytes);
+                bitmap()[index / 64] |= 1ull << (index % 64);
+            }
+
             pop_list();
 
             std::memset(memory, Pattern::ALLOCATED, pad_bytes);
 
+            // start loading the next block while the caller uses this one
+            if constexpr (Policy::prefetch != Prefetch::NONE)
+                if (free_list_)
+                    prefetch_head();
+
+            // header stays off limits to the user, payload opens up
+            sanitizer::Close(slot, header_size);
+            sanitizer::BlockAllocated(data_, memory + pad_bytes, block_size);
+
             return memory + pad_bytes;
         }
 
@@ -125,16 +310,258 @@ namespace ATL
         {
             if (!block) std::abort();
 
+            // foreign pointers, and in debug builds interior pointers too
+            if constexpr (Policy::debug)
+            {
+                if (!Owns(block)) std::abort();
+            }
+            else
+            {
+                if (!in_arena(block)) std::abort();
+            }
+
+            // double frees
+            if constexpr (Policy::debug)
+            {
+                const size_t index = SlotIndex(block);
+                if (!(bitmap()[index / 64] & (1ull << (index % 64)))) std::abort();
+            }
+
             uchar* mem = reinterpret_cast<uchar*>(block) - pad_bytes;
+            uchar* slot = mem + pad_bytes - header_size;
+
+            sanitizer::Open(slot, header_size);
 
             // safety check
             for (size_t i = 0; i < pad_bytes; ++i)
                 if (mem[i] != Pattern::ALLOCATED)
                     std::abort();
 
+            if constexpr (tracked)
+            {
+                const size_t index = SlotIndex(block);
+                bitmap()[index / 64] &= ~(1ull << (index % 64));
+            }
+
             std::memset(mem, Pattern::UNALLOCATED, pad_bytes);
 
-            push_list(reinterpret_cast<List*>(mem - vp_size));
+            sanitizer::Close(slot, header_size);
+
+            recycle(slot);
+        }
+
+        /**
+         * @brief Allocates `count` adjacent blocks as one region of
+         *        (count - 1) * stride + BlockSize() bytes, for short arrays
+         *        that should live next to related objects. Free runs are found
+         *        in the occupancy bitmap 64 slots at a time, or by walking the
+         *        guard bytes when the policy keeps no bitmap. The claimed
+         *        blocks are then unlinked from the free list in one pass over
+         *        it, so a call costs O(free blocks) and touches every free
+         *        slot: meant for occasional small arrays, not hot paths.
+         *        Slots of the run are reported individually by
+         *        ForEachAllocated. Release with FreeContiguous, never Free.
+         * 
+         * @param count At least 1.
+         * @return void* 
+         */
+        void* AllocateContiguous(size_t count)
+        {
+            if (!count || count > blocks) throw std::runtime_error("Out of blocks.");
+
+            size_t start = find_run(count, 0);
+
+            // quarantined blocks look free in the bitmap but are not reusable yet
+            if constexpr (quarantine_slots != 0)
+            {
+                for (bool clash = true; clash && start != blocks;)
+                {
+                    clash = false;
+
+                    for (size_t q = 0; q < this->q_count; ++q)
+                    {
+                        const size_t held = SlotIndex(reinterpret_cast<uchar*>(quarantine()[(this->q_head + q) % quarantine_slots]) + header_size);
+
+                        if (held >= start && held < start + count)
+                        {
+                            start = find_run(count, held + 1);
+                            clash = true;
+                            break;
+                        }
+                    }
+                }
+
+                // as in Allocate, the quarantine gives way before failing
+                if (start == blocks && this->q_count)
+                {
+                    while (this->q_count)
+                        release_quarantined();
+
+                    start = find_run(count, 0);
+                }
+            }
+
+            if (start == blocks) throw std::runtime_error("Out of blocks.");
+
+            for (size_t i = start; i < start + count; ++i)
+            {
+                uchar* slot = data_ + i * hb_size;
+
+                sanitizer::Open(slot, header_size);
+
+                // safety check
+                for (size_t j = 0; j < pad_bytes; ++j)
+                    if (slot[header_size - pad_bytes + j] != Pattern::UNALLOCATED)
+                        throw std::runtime_error("Corrupted block detected!");
+
+                if constexpr (Policy::debug)
+                {
+                    sanitizer::Open(slot + header_size, block_size);
+
+                    for (size_t j = 0; j < block_size; ++j)
+                        if (slot[header_size + j] != Policy::poison)
+                            throw std::runtime_error("Use after free detected!");
+                }
+
+                sanitizer::Close(slot, header_size);
+            }
+
+            unlink_run(start, count);
+
+            if constexpr (tracked)
+                for (size_t i = start; i < start + count; ++i)
+                    bitmap()[i / 64] |= 1ull << (i % 64);
+
+            uchar* first = data_ + start * hb_size;
+
+            // the first link is unused while allocated and holds the length
+            sanitizer::Open(first, header_size);
+            std::memset(first + header_size - pad_bytes, Pattern::ALLOCATED_RUN, pad_bytes);
+            set_run_length(first, count);
+            sanitizer::Close(first, header_size);
+
+            sanitizer::BlockAllocated(data_, first + header_size, (count - 1) * hb_size + block_size);
+
+            return first + header_size;
+        }
+
+        /**
+         * @brief Frees a region from AllocateContiguous. The run's length is
+         *        recorded in its first header, so a wrong count aborts instead
+         *        of freeing live neighbours.
+         * 
+         * @param block 
+         * @param count The count it was allocated with.
+         */
+        void FreeContiguous(void* block, size_t count) noexcept
+        {
+            if (!block || !count) std::abort();
+
+            if constexpr (Policy::debug)
+            {
+                if (!Owns(block)) std::abort();
+            }
+            else
+            {
+                if (!in_arena(block)) std::abort();
+            }
+
+            const size_t start = SlotIndex(block);
+            uchar* first = data_ + start * hb_size;
+
+            sanitizer::Open(first, header_size);
+
+            // safety check
+            for (size_t i = 0; i < pad_bytes; ++i)
+                if (first[header_size - pad_bytes + i] != Pattern::ALLOCATED_RUN)
+                    std::abort();
+
+            if (run_length(first) != count) std::abort();
+
+            for (size_t i = start; i < start + count; ++i)
+            {
+                if constexpr (tracked)
+                {
+                    unsigned long long& word = bitmap()[i / 64];
+
+                    if constexpr (Policy::debug)
+                        if (!(word & (1ull << (i % 64)))) std::abort();
+
+                    word &= ~(1ull << (i % 64));
+                }
+
+                // the user's data ran over the inner headers, rebuild them
+                uchar* slot = data_ + i * hb_size;
+
+                std::memset(slot + header_size - pad_bytes, Pattern::UNALLOCATED, pad_bytes);
+
+                if constexpr (Policy::debug)
+                    std::memset(slot + header_size, Policy::poison, block_size);
+            }
+
+            sanitizer::Close(first, header_size);
+
+            // the run was handed out as one block, so it is freed as one
+            sanitizer::BlockFreed(data_, first + header_size, count * hb_size - header_size);
+
+            for (size_t i = start; i < start + count; ++i)
+                retire(data_ + i * hb_size);
+        }
+
+        /**
+         * @brief Usable bytes per block.
+         * 
+         * @return size_t 
+         */
+        static constexpr size_t BlockSize() noexcept
+        {
+            return block_size;
+        }
+
+        /**
+         * @brief Number of blocks in the arena.
+         * 
+         * @return size_t 
+         */
+        static constexpr size_t BlockCount() noexcept
+        {
+            return blocks;
+        }
+
+        /**
+         * @brief Whether a pointer is the start of a block in this
+         *        allocator's arena. Interior pointers are rejected. O(1).
+         * 
+         * @param block 
+         * @return true 
+         * @return false 
+         */
+        bool Owns(const void* block) const noexcept
+        {
+            return in_arena(block) && static_cast<size_t>(static_cast<const uchar*>(block) - data_ - header_size) % hb_size == 0;
+        }
+
+        /**
+         * @brief Index of the slot holding a block. The block must be owned
+         *        by this allocator.
+         * 
+         * @param block 
+         * @return size_t 
+         */
+        size_t SlotIndex(const void* block) const noexcept
+        {
+            return static_cast<size_t>(static_cast<const uchar*>(block) - data_) / hb_size;
+        }
+
+        /**
+         * @brief Block stored in a slot, the inverse of SlotIndex.
+         * 
+         * @param index Less than BlockCount().
+         * @return void* 
+         */
+        void* FromIndex(size_t index) const noexcept
+        {
+            return data_ + header_size + index * hb_size;
         }
 
         /**
@@ -145,7 +572,52 @@ namespace ATL
          */
         bool CanAllocate() const noexcept
         {
-            return free_list_;
+            if constexpr (Policy::debug)
+                return free_list_ || this->q_count;
+            else
+                return free_list_;
+        }
+
+        /**
+         * @brief Calls fn(void* block) for every allocated block, in address
+         *        order. With an occupancy bitmap, free runs are skipped 64
+         *        slots at a time; otherwise every slot's guard bytes are read.
+         *        fn may free the block it is given.
+         * 
+         * @tparam Fn 
+         * @param fn 
+         */
+        template <typename Fn>
+        void ForEachAllocated(Fn&& fn) const
+        {
+            if constexpr (tracked)
+            {
+                const unsigned long long* words = bitmap();
+
+                for (size_t w = 0; w < bitmap_words; ++w)
+                {
+                    // copy, so frees from fn do not disturb the scan
+                    for (unsigned long long bits = words[w]; bits; bits &= bits - 1)
+                        fn(FromIndex(w * 64 + static_cast<size_t>(__builtin_ctzll(bits))));
+                }
+            }
+            else
+            {
+                for (size_t i = 0; i < blocks;)
+                {
+                    // read before fn, which may free the run
+                    const size_t used = used_span(i);
+
+                    if (!used)
+                    {
+                        ++i;
+                        continue;
+                    }
+
+                    for (const size_t end = i + used; i < end; ++i)
+                        fn(FromIndex(i));
+                }
+            }
         }
         
         // prevent copying of any kind
@@ -155,6 +627,21 @@ namespace ATL
 
     private:
 
+        /**
+         * @brief Whether a pointer falls inside the payload area of the
+         *        arena. Two compares, cheap enough for every Free().
+         * 
+         * @param block 
+         * @return true 
+         * @return false 
+         */
+        bool in_arena(const void* block) const noexcept
+        {
+            const uchar* memory = static_cast<const uchar*>(block);
+
+            return memory >= data_ + header_size && memory < data_ + bytes_allocated;
+        }
+
         /**
          * @brief Pushes into internal list.
          * 
@@ -162,7 +649,10 @@ namespace ATL
          */
         void push_list(List* list) noexcept
         {
-            list->next = free_list_;
+            sanitizer::Open(list, sizeof(List));
+            set_next(list, free_list_);
+            sanitizer::Close(list, sizeof(List));
+
             free_list_ = list;
         }
 
@@ -172,7 +662,341 @@ namespace ATL
          */
         void pop_list() noexcept
         {
-            free_list_ = free_list_->next;
+            free_list_ = next_of(free_list_);
+        }
+
+        /**
+         * @brief Prefetches the head of the free list: its header, which the
+         *        next Allocate() reads and writes, and with
+         *        Prefetch::LINK_AND_PAYLOAD its payload, for writing.
+         * 
+         */
+        void prefetch_head() const noexcept
+        {
+        #if defined(__GNUC__) || defined(__clang__)
+            __builtin_prefetch(free_list_, 1, 3);
+
+            if constexpr (Policy::prefetch == Prefetch::LINK_AND_PAYLOAD)
+                for (size_t i = 0; i < prefetch_bytes; i += 64)
+                    __builtin_prefetch(reinterpret_cast<const uchar*>(free_list_) + header_size + i, 1, 3);
+        #endif
+        }
+
+        /**
+         * @brief Reads a slot's link. Links may sit at addresses aligned to
+         *        less than their size, hence memcpy.
+         * 
+         * @param list 
+         * @return List* 
+         */
+        List* next_of(const List* list) const noexcept
+        {
+            Link link;
+            std::memcpy(&link, list, sizeof(Link));
+
+            if constexpr (std::is_pointer<Link>::value)
+                return static_cast<List*>(link);
+            else
+                return link ? reinterpret_cast<List*>(data_ + (static_cast<size_t>(link) - 1) * hb_size) : nullptr;
+        }
+
+        /**
+         * @brief Writes a slot's link.
+         * 
+         * @param list 
+         * @param next 
+         */
+        void set_next(List* list, const List* next) noexcept
+        {
+            Link link;
+
+            if constexpr (std::is_pointer<Link>::value)
+                link = const_cast<List*>(next);
+            else
+                link = next ? static_cast<Link>(static_cast<size_t>(reinterpret_cast<const uchar*>(next) - data_) / hb_size + 1) : Link(0);
+
+            std::memcpy(list, &link, sizeof(Link));
+        }
+
+        /**
+         * @brief Stores a run's length in its first slot's link.
+         * 
+         * @param slot 
+         * @param count 
+         */
+        static void set_run_length(uchar* slot, size_t count) noexcept
+        {
+            Link link;
+
+            if constexpr (std::is_pointer<Link>::value)
+                link = reinterpret_cast<Link>(count);
+            else
+                link = static_cast<Link>(count);
+
+            std::memcpy(slot, &link, sizeof(Link));
+        }
+
+        /**
+         * @brief Length stored by set_run_length.
+         * 
+         * @param slot 
+         * @return size_t 
+         */
+        static size_t run_length(const uchar* slot) noexcept
+        {
+            Link link;
+            std::memcpy(&link, slot, sizeof(Link));
+
+            if constexpr (std::is_pointer<Link>::value)
+                return reinterpret_cast<size_t>(link);
+            else
+                return static_cast<size_t>(link);
+        }
+
+        /**
+         * @brief Occupancy bitmap, one bit per slot.
+         * 
+         * @return unsigned long long* 
+         */
+        unsigned long long* bitmap() const noexcept
+        {
+            return meta_.get();
+        }
+
+        /**
+         * @brief Quarantine ring (debug only).
+         * 
+         * @return List** 
+         */
+        List** quarantine() const noexcept
+        {
+            return reinterpret_cast<List**>(meta_.get() + bitmap_words);
+        }
+
+        /**
+         * @brief Poisons and annotates a slot whose guard bytes are already
+         *        reset, then retires it.
+         * 
+         * @param slot 
+         */
+        void recycle(uchar* slot) noexcept
+        {
+            if constexpr (Policy::debug)
+                std::memset(slot + header_size, Policy::poison, block_size);
+
+            // any access through a stale pointer is now reported by the tools
+            sanitizer::BlockFreed(data_, slot + header_size, hb_size - header_size);
+
+            retire(slot);
+        }
+
+        /**
+         * @brief Hands a freed, already annotated slot to the quarantine
+         *        (debug) or the free list.
+         * 
+         * @param slot 
+         */
+        void retire(uchar* slot) noexcept
+        {
+            if constexpr (quarantine_slots != 0)
+            {
+                if (this->q_count == quarantine_slots)
+                    release_quarantined();
+
+                quarantine()[(this->q_head + this->q_count++) % quarantine_slots] = reinterpret_cast<List*>(slot);
+                return;
+            }
+
+            push_list(reinterpret_cast<List*>(slot));
+        }
+
+        /**
+         * @brief Slots in use from `index` on, read from its guard bytes: the
+         *        length of an AllocateContiguous run, whose inner headers hold
+         *        user data, 1 for a single block and 0 for a free one.
+         * 
+         * @param index 
+         * @return size_t 
+         */
+        size_t used_span(size_t index) const noexcept
+        {
+            const uchar* slot = data_ + index * hb_size;
+
+            sanitizer::Open(slot, header_size);
+
+            const uchar mark = slot[header_size - pad_bytes];
+            const size_t used = mark == Pattern::ALLOCATED_RUN ? run_length(slot) : mark != Pattern::UNALLOCATED;
+
+            sanitizer::Close(slot, header_size);
+
+            return used;
+        }
+
+        /**
+         * @brief First run of `count` free slots at or after `from`, found a
+         *        bitmap word at a time: full and empty words cost a single
+         *        compare, mixed words are walked run by run with ctz. Without
+         *        a bitmap the guard bytes are walked instead, a slot or an
+         *        allocated run at a time.
+         * 
+         * @param count 
+         * @param from The start of a slot or run, or 0.
+         * @return size_t blocks when there is no such run.
+         */
+        size_t find_run(size_t count, size_t from) const noexcept
+        {
+            if constexpr (!tracked)
+            {
+                size_t run = 0;
+
+                for (size_t i = from; i < blocks;)
+                {
+                    const size_t used = used_span(i);
+
+                    if (used)
+                    {
+                        run = 0;
+                        i += used;
+                        continue;
+                    }
+
+                    if (++run == count) return i + 1 - count;
+                    ++i;
+                }
+
+                return blocks;
+            }
+
+            const unsigned long long* words = bitmap();
+            size_t run = 0;
+            size_t start = blocks;
+
+            for (size_t w = from / 64; w < bitmap_words; ++w)
+            {
+                unsigned long long vacant = ~words[w];
+
+                if (w == from / 64) vacant &= ~0ull << (from % 64);
+                if (w == bitmap_words - 1 && blocks % 64) vacant &= (1ull << (blocks % 64)) - 1;
+
+                if (vacant == ~0ull)
+                {
+                    if (!run) start = w * 64;
+                    run += 64;
+                    if (run >= count) return start;
+                    continue;
+                }
+
+                for (size_t b = 0; b < 64;)
+                {
+                    const unsigned long long rest = vacant >> b;
+
+                    // used slots break the run
+                    if (!(rest & 1))
+                    {
+                        run = 0;
+                        if (!rest) break;
+                        b += static_cast<size_t>(__builtin_ctzll(rest));
+                        continue;
+                    }
+
+                    const size_t length = static_cast<size_t>(__builtin_ctzll(~rest));
+
+                    if (!run) start = w * 64 + b;
+                    run += length;
+                    if (run >= count) return start;
+
+                    b += length;
+                }
+            }
+
+            return blocks;
+        }
+
+        /**
+         * @brief Takes the slots of a run out of the free list.
+         * 
+         * @param start 
+         * @param count 
+         */
+        void unlink_run(size_t start, size_t count) noexcept
+        {
+            const List* low = reinterpret_cast<List*>(data_ + start * hb_size);
+            const List* high = reinterpret_cast<List*>(data_ + (start + count) * hb_size);
+
+            List* prev = nullptr;
+
+            for (List* node = free_list_; count && node;)
+            {
+                sanitizer::Open(node, sizeof(List));
+                List* next = next_of(node);
+                sanitizer::Close(node, sizeof(List));
+
+                if (node >= low && node < high)
+                {
+                    if (prev)
+                    {
+                        sanitizer::Open(prev, sizeof(List));
+                        set_next(prev, next);
+                        sanitizer::Close(prev, sizeof(List));
+                    }
+                    else
+                    {
+                        free_list_ = next;
+                    }
+
+                    --count;
+                }
+                else
+                {
+                    prev = node;
+                }
+
+                node = next;
+            }
+        }
+
+        /**
+         * @brief Moves the oldest quarantined block to the free list.
+         * 
+         */
+        void release_quarantined() noexcept
+        {
+            push_list(quarantine()[this->q_head]);
+            this->q_head = (this->q_head + 1) % quarantine_slots;
+            --this->q_count;
+        }
+    };
+
+    /**
+     * @brief std::unique_ptr deleter returning objects to the pool they came
+     *        from.
+     * 
+     * @tparam Alloc TypeAllocator the objects came from.
+     */
+    template <typename Alloc>
+    class PoolDeleter
+    {
+        Alloc* alloc_;
+
+    public:
+
+        /**
+         * @brief Construct a deleter bound to a pool.
+         * 
+         * @param alloc 
+         */
+        explicit PoolDeleter(Alloc& alloc) noexcept : alloc_(&alloc) {}
+
+        /**
+         * @brief Destroys and frees an object.
+         * 
+         * @tparam T 
+         * @param block 
+         */
+        template <typename T>
+        void operator()(T* block) const noexcept
+        {
+            alloc_->Free(block);
         }
     };
 
@@ -181,17 +1005,23 @@ namespace ATL
      * 
      * @tparam T 
      * @tparam blocks 
+     * @tparam Policy ReleasePolicy or DebugPolicy
+     * @tparam Storage HeapStorage, MappedStorage or HugePageStorage
      */
-    template <typename T, size_t blocks>
-    struct TypeAllocator : public MemoryAllocator<alignof(T) + sizeof(T), blocks>
+    template <typename T, size_t blocks, typename Policy = DefaultPoolPolicy, typename Storage = HeapStorage>
+    struct TypeAllocator : public MemoryAllocator<alignof(T) + sizeof(T), blocks, Policy, Storage>
     {
         static_assert(!std::is_same<T, void>::value, "Cannot allocate type void.");
 
         // the type of the parent class
-        using base = MemoryAllocator<alignof(T) + sizeof(T), blocks>;
+        using base = MemoryAllocator<alignof(T) + sizeof(T), blocks, Policy, Storage>;
+
+        // owning pointer that frees back into this allocator
+        using unique_ptr = std::unique_ptr<T, PoolDeleter<TypeAllocator>>;
 
         /**
-         * @brief Allocates and constructs object.
+         * @brief Allocates and constructs object in place, forwarding the
+         *        arguments so rvalues are moved rather than copied.
          * 
          * @tparam Args 
          * @param args 
@@ -200,7 +1030,31 @@ namespace ATL
         template <typename... Args>
         T* Allocate(Args&&... args)
         {
-            return new(base::Allocate()) T(args...);
+            void* mem = base::Allocate();
+
+            try
+            {
+                return new(mem) T(std::forward<Args>(args)...);
+            }
+            catch (...)
+            {
+                base::Free(mem);
+                throw;
+            }
+        }
+
+        /**
+         * @brief Allocates and constructs object in place, owned by a
+         *        unique_ptr that frees it back into this allocator.
+         * 
+         * @tparam Args 
+         * @param args 
+         * @return unique_ptr 
+         */
+        template <typename... Args>
+        unique_ptr Make(Args&&... args)
+        {
+            return unique_ptr(Allocate(std::forward<Args>(args)...), PoolDeleter<TypeAllocator>(*this));
         }
 
         /**
@@ -215,5 +1069,226 @@ namespace ATL
             block->~T();
             base::Free(block);
         }
+
+        /**
+         * @brief Calls fn(T& object) for every live object, in address order.
+         *        fn may free the object it is given.
+         * 
+         * @tparam Fn 
+         * @param fn 
+         */
+        template <typename Fn>
+        void ForEachAllocated(Fn&& fn) const
+        {
+            base::ForEachAllocated([&fn](void* block) { fn(*static_cast<T*>(block)); });
+        }
+    };
+
+    /**
+     * @brief CRTP base giving a class (and everything derived from it) class
+     *        level operator new/delete backed by a pool of sizeof(T) blocks:
+     *
+     *            class Widget : public ATL::PoolAllocated<Widget, 128> { ... };
+     *
+     *        Requests the pool cannot serve (larger derived classes, arrays,
+     *        alignment beyond alignof(std::max_align_t)) go to the global
+     *        operators, and deletes are routed by address, so mixed hierarchies
+     *        are safe. Exhaustion throws std::bad_alloc (nullptr for nothrow).
+     *        Placement new and the nothrow forms keep working as they do for
+     *        classes without their own operators.
+     * 
+     * @tparam T 
+     * @tparam blocks 
+     */
+    template <typename T, size_t blocks>
+    class PoolAllocated
+    {
+    public:
+
+        /**
+         * @brief The pool shared by T and its derived classes, created on
+         *        first use and never destroyed, so objects deleted from
+         *        other static destructors still find it.
+         * 
+         * @return MemoryAllocator<sizeof(T), blocks>& 
+         */
+        static auto& Pool()
+        {
+            static auto* pool = new MemoryAllocator<sizeof(T), blocks>;
+            return *pool;
+        }
+
+        static void* operator new(std::size_t size)
+        {
+            if (!fits(size, alignof(std::max_align_t))) return ::operator new(size);
+            if (!Pool().CanAllocate()) throw std::bad_alloc();
+            return Pool().Allocate();
+        }
+
+        static void* operator new(std::size_t size, std::align_val_t align)
+        {
+            if (!fits(size, static_cast<size_t>(align))) return ::operator new(size, align);
+            if (!Pool().CanAllocate()) throw std::bad_alloc();
+            return Pool().Allocate();
+        }
+
+        static void* operator new(std::size_t size, const std::nothrow_t& tag) noexcept
+        {
+            if (!fits(size, alignof(std::max_align_t))) return ::operator new(size, tag);
+            return Pool().CanAllocate() ? allocate_nothrow() : nullptr;
+        }
+
+        static void* operator new(std::size_t size, std::align_val_t align, const std::nothrow_t& tag) noexcept
+        {
+            if (!fits(size, static_cast<size_t>(align))) return ::operator new(size, align, tag);
+            return Pool().CanAllocate() ? allocate_nothrow() : nullptr;
+        }
+
+        // placement new, hidden by the overloads above otherwise
+        static void* operator new(std::size_t, void* where) noexcept
+        {
+            return where;
+        }
+
+        static void* operator new[](std::size_t size)
+        {
+            return ::operator new[](size);
+        }
+
+        static void* operator new[](std::size_t size, std::align_val_t align)
+        {
+            return ::operator new[](size, align);
+        }
+
+        static void* operator new[](std::size_t size, const std::nothrow_t& tag) noexcept
+        {
+            return ::operator new[](size, tag);
+        }
+
+        static void* operator new[](std::size_t size, std::align_val_t align, const std::nothrow_t& tag) noexcept
+        {
+            return ::operator new[](size, align, tag);
+        }
+
+        static void* operator new[](std::size_t, void* where) noexcept
+        {
+            return where;
+        }
+
+        static void operator delete(void* block) noexcept
+        {
+            release(block);
+        }
+
+        static void operator delete(void* block, std::size_t) noexcept
+        {
+            release(block);
+        }
+
+        static void operator delete(void* block, std::align_val_t align) noexcept
+        {
+            if (Pool().Owns(block)) Pool().Free(block);
+            else ::operator delete(block, align);
+        }
+
+        static void operator delete(void* block, std::size_t, std::align_val_t align) noexcept
+        {
+            operator delete(block, align);
+        }
+
+        static void operator delete(void* block, const std::nothrow_t&) noexcept
+        {
+            release(block);
+        }
+
+        static void operator delete(void* block, std::align_val_t align, const std::nothrow_t&) noexcept
+        {
+            operator delete(block, align);
+        }
+
+        static void operator delete(void*, void*) noexcept {}
+
+        static void operator delete[](void* block) noexcept
+        {
+            ::operator delete[](block);
+        }
+
+        static void operator delete[](void* block, std::size_t) noexcept
+        {
+            ::operator delete[](block);
+        }
+
+        static void operator delete[](void* block, std::align_val_t align) noexcept
+        {
+            ::operator delete[](block, align);
+        }
+
+        static void operator delete[](void* block, std::size_t, std::align_val_t align) noexcept
+        {
+            ::operator delete[](block, align);
+        }
+
+        static void operator delete[](void* block, const std::nothrow_t&) noexcept
+        {
+            ::operator delete[](block);
+        }
+
+        static void operator delete[](void* block, std::align_val_t align, const std::nothrow_t&) noexcept
+        {
+            ::operator delete[](block, align);
+        }
+
+        static void operator delete[](void*, void*) noexcept {}
+
+    protected:
+
+        // only meant to be used as a base
+        PoolAllocated() noexcept = default;
+        ~PoolAllocated() noexcept = default;
+
+    private:
+
+        /**
+         * @brief Whether a request can be served by the pool.
+         * 
+         * @param size 
+         * @param align 
+         * @return true 
+         * @return false 
+         */
+        static bool fits(size_t size, size_t align) noexcept
+        {
+            return size <= sizeof(T) && align <= alignof(std::max_align_t);
+        }
+
+        /**
+         * @brief Allocates from a pool known to have room.
+         * 
+         * @return void* nullptr if the block was found corrupted.
+         */
+        static void* allocate_nothrow() noexcept
+        {
+            try
+            {
+                return Pool().Allocate();
+            }
+            catch (...)
+            {
+                return nullptr;
+            }
+        }
+
+        /**
+         * @brief Frees into the pool or the global heap, whichever owns it.
+         * 
+         * @param block 
+         */
+        static void release(void* block) noexcept
+        {
+            if (!block) return;
+
+            if (Pool().Owns(block)) Pool().Free(block);
+            else ::operator delete(block);
+        }
     };
 }
@@ -0,0 +1,358 @@
+/******************************************************************************/
+/*
+* @file   numaallocator.h
+* @author Aditya Harsh
+* @brief  Fixed-size allocator with one arena shard per NUMA node. Linux only,
+*         talks to the kernel directly so libnuma is not required.
+*/
+/******************************************************************************/
+
+#pragma once
+
+#include "osmemory.h" /* ATL::MapPages, ATL::UnmapPages */
+#include "spinlock.h" /* ATL::SpinLock                  */
+
+#include <cstddef>    /* std::max_align_t             */
+#include <cstdio>     /* std::fopen, std::fgets       */
+#include <cstdlib>    /* std::abort, std::strtoul     */
+#include <cstring>    /* std::memset                  */
+#include <mutex>      /* std::lock_guard              */
+#include <stdexcept>  /* std::runtime_error           */
+
+#include <sys/syscall.h> /* SYS_getcpu, SYS_mbind */
+#include <unistd.h>      /* syscall               */
+
+namespace ATL
+{
+    namespace numa
+    {
+        // highest node id we keep track of
+        static constexpr unsigned max_node_id = 64;
+
+        /**
+         * @brief Reads the ids of the online nodes from sysfs. Machines (or
+         *        containers) without NUMA information report a single node 0.
+         *
+         * @param ids Output array.
+         * @param capacity Size of the output array.
+         * @return size_t Number of ids written (at least 1).
+         */
+        inline size_t OnlineNodes(unsigned* ids, size_t capacity) noexcept
+        {
+            size_t count = 0;
+
+            if (std::FILE* file = std::fopen("/sys/devices/system/node/online", "r"))
+            {
+                char line[256] = {};
+
+                // format is a range list, e.g. "0-1,4"
+                if (std::fgets(line, sizeof(line), file))
+                {
+                    char* cursor = line;
+
+                    while (*cursor >= '0' && *cursor <= '9')
+                    {
+                        unsigned long first = std::strtoul(cursor, &cursor, 10);
+                        unsigned long last = first;
+
+                        if (*cursor == '-') last = std::strtoul(cursor + 1, &cursor, 10);
+
+                        for (unsigned long id = first; id <= last && id < max_node_id && count < capacity; ++id)
+                            ids[count++] = static_cast<unsigned>(id);
+
+                        if (*cursor == ',') ++cursor;
+                    }
+                }
+
+                std::fclose(file);
+            }
+
+            if (!count) ids[count++] = 0;
+
+            return count;
+        }
+
+        /**
+         * @brief Node of the CPU the calling thread runs on. getcpu is a real
+         *        syscall here, so the answer is cached per thread and refreshed
+         *        periodically to follow migrations.
+         *
+         * @return unsigned
+         */
+        inline unsigned CurrentNode() noexcept
+        {
+            static constexpr unsigned refresh_interval = 256;
+
+            thread_local unsigned node = 0;
+            thread_local unsigned countdown = 0;
+
+            if (!countdown)
+            {
+                unsigned cpu = 0;
+                unsigned current = 0;
+
+                if (syscall(SYS_getcpu, &cpu, &current, nullptr) == 0)
+                    node = current;
+
+                countdown = refresh_interval;
+            }
+
+            --countdown;
+
+            return node;
+        }
+
+        /**
+         * @brief Sets the placement policy of a range of pages that has not
+         *        been touched yet. MPOL_PREFERRED is used rather than MPOL_BIND
+         *        so an exhausted node spills over instead of OOM-killing us.
+         *
+         * @param mem Page aligned.
+         * @param bytes
+         * @param node
+         * @return true The kernel accepted the policy.
+         * @return false No NUMA support (or not permitted), pages stay local.
+         */
+        inline bool BindToNode(void* mem, size_t bytes, unsigned node) noexcept
+        {
+            static constexpr int mpol_preferred = 1;
+
+            if (node >= max_node_id) return false;
+
+            unsigned long mask = 1UL << node;
+
+            // the kernel reads maxnode - 1 bits
+            return syscall(SYS_mbind, mem, bytes, mpol_preferred, &mask, sizeof(mask) * 8 + 1, 0) == 0;
+        }
+    }
+
+    /**
+     * @brief Fixed-size allocator keeping one shard of blocks per NUMA node.
+     *        Allocations are served from the caller's node (falling back to
+     *        remote nodes when it runs dry), and frees always go back to the
+     *        block's home node. Thread-safe.
+     *
+     * @tparam block_size
+     * @tparam blocks_per_node
+     * @tparam max_nodes Shards beyond this many nodes are not created.
+     */
+    template <size_t block_size, size_t blocks_per_node, size_t max_nodes = 8>
+    class NumaMemoryAllocator
+    {
+        // safety checking
+        static_assert(block_size >= 1, "Block size must be at least 1 byte.");
+        static_assert(blocks_per_node >= 1, "At least 1 block must be allocated.");
+        static_assert(max_nodes >= 1, "At least 1 node must be supported.");
+
+        // internal memory type
+        using uchar = unsigned char;
+
+        // byte patterns to mark memory blocks
+        enum Pattern : uchar
+        {
+            UNALLOCATED = 0xAA,
+            ALLOCATED = 0xBB
+        };
+
+        // represents a list object
+        struct List
+        {
+            List* next = nullptr;
+        };
+
+        // per-node state, kept on its own cache line
+        struct alignas(64) Shard
+        {
+            SpinLock lock{};
+            List* free_list = nullptr;
+            unsigned node = 0;
+            bool bound = false;
+        };
+
+        // meta data
+        static constexpr size_t pad_bytes = 2;
+        static constexpr size_t align = alignof(std::max_align_t);
+        static constexpr size_t header_size = (sizeof(List) + pad_bytes + align - 1) / align * align;
+        static constexpr size_t hb_size = (header_size + block_size + align - 1) / align * align;
+
+        // all shards live in one mapping, shard i at data_ + i * shard_bytes_
+        uchar* data_;
+        size_t shard_bytes_;
+        size_t nodes_;
+        Shard shards_[max_nodes];
+
+    public:
+
+        /**
+         * @brief Construct a new NUMA Memory Allocator object.
+         *
+         */
+        NumaMemoryAllocator() : data_(nullptr), shard_bytes_(RoundToPages(hb_size * blocks_per_node)), nodes_(0), shards_()
+        {
+            unsigned ids[max_nodes] = {};
+            nodes_ = numa::OnlineNodes(ids, max_nodes);
+
+            data_ = static_cast<uchar*>(MapPages(shard_bytes_ * nodes_));
+
+            for (size_t n = 0; n < nodes_; ++n)
+            {
+                Shard& shard = shards_[n];
+                uchar* arena = data_ + n * shard_bytes_;
+
+                shard.node = ids[n];
+                // policy must be set before the pages are first touched
+                shard.bound = numa::BindToNode(arena, shard_bytes_, ids[n]);
+
+                for (size_t i = blocks_per_node; i-- > 0;)
+                {
+                    uchar* slot = arena + i * hb_size;
+                    std::memset(slot + header_size - pad_bytes, Pattern::UNALLOCATED, pad_bytes);
+                    push_list(shard, reinterpret_cast<List*>(slot));
+                }
+            }
+        }
+
+        /**
+         * @brief Destructor
+         *
+         */
+        ~NumaMemoryAllocator() noexcept
+        {
+            UnmapPages(data_, shard_bytes_ * nodes_);
+        }
+
+        /**
+         * @brief Allocates from the caller's node, stealing from other nodes
+         *        only when the local shard is exhausted.
+         *
+         * @return void*
+         */
+        void* Allocate()
+        {
+            const size_t home = shard_of_node(numa::CurrentNode());
+
+            for (size_t i = 0; i < nodes_; ++i)
+            {
+                Shard& shard = shards_[(home + i) % nodes_];
+                std::lock_guard<SpinLock> guard(shard.lock);
+
+                if (!shard.free_list) continue;
+
+                uchar* memory = reinterpret_cast<uchar*>(shard.free_list) + header_size;
+                uchar* pad = memory - pad_bytes;
+
+                // safety check
+                for (size_t j = 0; j < pad_bytes; ++j)
+                    if (pad[j] != Pattern::UNALLOCATED)
+                        throw std::runtime_error("Corrupted block detected!");
+
+                shard.free_list = shard.free_list->next;
+
+                std::memset(pad, Pattern::ALLOCATED, pad_bytes);
+
+                return memory;
+            }
+
+            throw std::runtime_error("Out of blocks.");
+        }
+
+        /**
+         * @brief Frees memory back to the shard of the node it was placed on.
+         *
+         * @param block
+         */
+        void Free(void* block) noexcept
+        {
+            if (!block) std::abort();
+
+            uchar* memory = reinterpret_cast<uchar*>(block);
+
+            if (memory < data_ + header_size || memory >= data_ + shard_bytes_ * nodes_)
+                std::abort();
+
+            uchar* pad = memory - pad_bytes;
+
+            // safety check
+            for (size_t i = 0; i < pad_bytes; ++i)
+                if (pad[i] != Pattern::ALLOCATED)
+                    std::abort();
+
+            Shard& shard = shards_[static_cast<size_t>(memory - data_) / shard_bytes_];
+            std::lock_guard<SpinLock> guard(shard.lock);
+
+            std::memset(pad, Pattern::UNALLOCATED, pad_bytes);
+
+            push_list(shard, reinterpret_cast<List*>(memory - header_size));
+        }
+
+        /**
+         * @brief Node a block was placed on.
+         *
+         * @param block
+         * @return unsigned
+         */
+        unsigned HomeNode(const void* block) const noexcept
+        {
+            const uchar* memory = static_cast<const uchar*>(block);
+            return shards_[static_cast<size_t>(memory - data_) / shard_bytes_].node;
+        }
+
+        /**
+         * @brief Number of shards (online nodes, capped at max_nodes).
+         *
+         * @return size_t
+         */
+        size_t NodeCount() const noexcept
+        {
+            return nodes_;
+        }
+
+        /**
+         * @brief Whether the kernel accepted the placement policy of a shard.
+         *        False on kernels without NUMA support; the shard still works.
+         *
+         * @param shard
+         * @return true
+         * @return false
+         */
+        bool IsBound(size_t shard) const noexcept
+        {
+            return shard < nodes_ && shards_[shard].bound;
+        }
+
+        // prevent copying of any kind
+        NumaMemoryAllocator& operator=(NumaMemoryAllocator& rhs) = delete;
+        NumaMemoryAllocator(const NumaMemoryAllocator& rhs) = delete;
+        NumaMemoryAllocator(NumaMemoryAllocator&& rhs) = delete;
+
+    private:
+
+        /**
+         * @brief Maps a node id to its shard, defaulting to the first one for
+         *        nodes beyond max_nodes.
+         *
+         * @param node
+         * @return size_t
+         */
+        size_t shard_of_node(unsigned node) const noexcept
+        {
+            for (size_t i = 0; i < nodes_; ++i)
+                if (shards_[i].node == node)
+                    return i;
+
+            return 0;
+        }
+
+        /**
+         * @brief Pushes into a shard's list.
+         *
+         * @param shard
+         * @param list
+         */
+        static void push_list(Shard& shard, List* list) noexcept
+        {
+            list->next = shard.free_list;
+            shard.free_list = list;
+        }
+    };
+}
@@ -0,0 +1,194 @@
+/******************************************************************************/
+/*
+* @file   objectpool.h
+* @author Aditya Harsh
+* @brief  Pool of objects that stay constructed while free, so their internal
+*         buffers survive between uses.
+*/
+/******************************************************************************/
+
+#pragma once
+
+#include "memoryallocator.h" /* ATL::MemoryAllocator */
+
+#include <cstdlib>     /* std::abort      */
+#include <memory>      /* std::unique_ptr */
+#include <new>         /* placement new   */
+#include <type_traits> /* std::void_t     */
+#include <utility>     /* std::forward    */
+
+namespace ATL
+{
+    namespace detail
+    {
+        // whether obj.reset(args...) is well-formed
+        template <typename Void, typename T, typename... Args>
+        struct HasReset : std::false_type {};
+
+        template <typename T, typename... Args>
+        struct HasReset<std::void_t<decltype(std::declval<T&>().reset(std::declval<Args>()...))>, T, Args...> : std::true_type {};
+    }
+
+    /**
+     * @brief Default reuse hook: calls obj.reset(args...) when T has such a
+     *        member, and leaves the object as it was released otherwise. The
+     *        object is never replaced, so passing arguments to Acquire()
+     *        requires a matching reset(args...) or a custom hook.
+     *
+     * @tparam T
+     */
+    template <typename T>
+    struct ResetObject
+    {
+        template <typename... Args>
+        void operator()(T& obj, Args&&... args) const
+        {
+            if constexpr (detail::HasReset<void, T, Args...>::value)
+                obj.reset(std::forward<Args>(args)...);
+            else
+                static_assert(sizeof...(Args) == 0, "Acquire(args...) needs T::reset(args...) or a Reset hook taking args.");
+        }
+    };
+
+    /**
+     * @brief Recycling pool. Acquire() constructs T only the first time a slot
+     *        is used; afterwards it hands back a released object after running
+     *        the Reset hook on it, with Acquire's arguments. Release() never
+     *        runs ~T(), so members such as std::vector keep their capacity
+     *        across uses. Objects still held by the caller when the pool dies
+     *        are not destroyed. Debug policies abort on double and foreign
+     *        releases.
+     *
+     * @tparam T
+     * @tparam blocks
+     * @tparam Reset Callable invoked as reset(T&, args...) on reuse.
+     * @tparam Policy ReleasePolicy or DebugPolicy
+     */
+    template <typename T, size_t blocks, typename Reset = ResetObject<T>, typename Policy = DefaultPoolPolicy>
+    class ObjectPool
+    {
+        static_assert(!std::is_same<T, void>::value, "Cannot allocate type void.");
+
+        // raw slots for objects that were never constructed yet
+        MemoryAllocator<alignof(T) + sizeof(T), blocks, Policy> pool_;
+        // released objects, still constructed
+        std::unique_ptr<T*[]> recycled_;
+        size_t recycled_count_;
+        // per slot, whether its object is sitting in recycled_ (debug only)
+        std::unique_ptr<bool[]> released_;
+        Reset reset_;
+
+    public:
+
+        /**
+         * @brief Construct a new Object Pool object.
+         *
+         * @param reset
+         */
+        explicit ObjectPool(Reset reset = Reset()) : pool_(), recycled_(new T*[blocks]), recycled_count_(0),
+                                                     released_(Policy::debug ? new bool[blocks]() : nullptr), reset_(reset) {}
+
+        /**
+         * @brief Destroys the objects sitting in the pool.
+         *
+         */
+        ~ObjectPool() noexcept
+        {
+            Shrink();
+        }
+
+        /**
+         * @brief Hands out a recycled object after passing it and args to the
+         *        Reset hook, or constructs a new one from args when none is
+         *        available.
+         *
+         * @tparam Args
+         * @param args
+         * @return T*
+         */
+        template <typename... Args>
+        T* Acquire(Args&&... args)
+        {
+            if (recycled_count_)
+            {
+                T* obj = recycled_[recycled_count_ - 1];
+                reset_(*obj, std::forward<Args>(args)...);
+                --recycled_count_;
+
+                if constexpr (Policy::debug)
+                    released_[pool_.SlotIndex(obj)] = false;
+
+                return obj;
+            }
+
+            void* mem = pool_.Allocate();
+
+            try
+            {
+                return new(mem) T(std::forward<Args>(args)...);
+            }
+            catch (...)
+            {
+                pool_.Free(mem);
+                throw;
+            }
+        }
+
+        /**
+         * @brief Returns an object to the pool without destroying it.
+         *
+         * @param obj
+         */
+        void Release(T* obj) noexcept
+        {
+            // safety check
+            if (!obj || recycled_count_ == blocks) std::abort();
+
+            // foreign objects and double releases
+            if constexpr (Policy::debug)
+            {
+                if (!pool_.Owns(obj)) std::abort();
+
+                bool& released = released_[pool_.SlotIndex(obj)];
+                if (released) std::abort();
+                released = true;
+            }
+
+            recycled_[recycled_count_++] = obj;
+        }
+
+        /**
+         * @brief Destroys every object sitting in the pool, releasing whatever
+         *        memory they hold internally.
+         *
+         */
+        void Shrink() noexcept
+        {
+            while (recycled_count_)
+            {
+                T* obj = recycled_[--recycled_count_];
+
+                if constexpr (Policy::debug)
+                    released_[pool_.SlotIndex(obj)] = false;
+
+                obj->~T();
+                pool_.Free(obj);
+            }
+        }
+
+        /**
+         * @brief Number of constructed objects waiting for reuse.
+         *
+         * @return size_t
+         */
+        size_t RecycledCount() const noexcept
+        {
+            return recycled_count_;
+        }
+
+        // prevent copying of any kind
+        ObjectPool& operator=(ObjectPool& rhs) = delete;
+        ObjectPool(const ObjectPool& rhs) = delete;
+        ObjectPool(ObjectPool&& rhs) = delete;
+    };
+}
@@ -0,0 +1,140 @@
+/******************************************************************************/
+/*
+* @file   osmemory.h
+* @author Aditya Harsh
+* @brief  Thin wrappers around the OS page allocator (POSIX mmap), and the
+*         backing-store policies built on them. HeapStorage lives in
+*         memoryallocator.h, which stays portable.
+*/
+/******************************************************************************/
+
+#pragma once
+
+#include "memoryallocator.h" /* ATL::HeapStorage */
+
+#include <cerrno>    /* errno, ENOMEM      */
+#include <cstddef>   /* std::size_t        */
+#include <stdexcept> /* std::runtime_error */
+
+#include <sys/mman.h> /* mmap, munmap, mprotect, madvise */
+#include <unistd.h>   /* sysconf                         */
+
+namespace ATL
+{
+    /**
+     * @brief Size of a virtual memory page.
+     *
+     * @return size_t
+     */
+    inline size_t PageSize() noexcept
+    {
+        static const size_t page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        return page_size;
+    }
+
+    /**
+     * @brief Rounds a byte count up to a whole number of pages.
+     *
+     * @param bytes
+     * @return size_t
+     */
+    inline size_t RoundToPages(size_t bytes) noexcept
+    {
+        const size_t page = PageSize();
+        return (bytes + page - 1) / page * page;
+    }
+
+    /**
+     * @brief Maps fresh, zeroed, private pages. Pages are not backed by
+     *        physical memory until first touched.
+     *
+     * @param bytes Must be a multiple of the page size.
+     * @return void*
+     */
+    inline void* MapPages(size_t bytes)
+    {
+        void* mem = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+        if (mem == MAP_FAILED) throw std::runtime_error("Failed to map pages.");
+
+        return mem;
+    }
+
+    /**
+     * @brief Makes pages inaccessible, so any access raises SIGSEGV.
+     *
+     * @param mem Must be page aligned.
+     * @param bytes Must be a multiple of the page size.
+     */
+    inline void ProtectPages(void* mem, size_t bytes)
+    {
+        if (mprotect(mem, bytes, PROT_NONE))
+        {
+            // each protected range splits the mapping, and mappings are capped
+            if (errno == ENOMEM) throw std::runtime_error("Failed to protect pages: out of memory mappings (vm.max_map_count).");
+
+            throw std::runtime_error("Failed to protect pages.");
+        }
+    }
+
+    /**
+     * @brief Returns pages obtained from MapPages.
+     *
+     * @param mem
+     * @param bytes
+     */
+    inline void UnmapPages(void* mem, size_t bytes) noexcept
+    {
+        if (mem) munmap(mem, bytes);
+    }
+
+    /**
+     * @brief Backing store mapped straight from the OS, page aligned and
+     *        populated lazily.
+     *
+     */
+    struct MappedStorage
+    {
+        static void* Acquire(size_t bytes)
+        {
+            return MapPages(RoundToPages(bytes));
+        }
+
+        static void Release(void* mem, size_t bytes) noexcept
+        {
+            UnmapPages(mem, RoundToPages(bytes));
+        }
+    };
+
+    /**
+     * @brief Backing store on 2 MiB huge pages, cutting TLB misses on large
+     *        arenas. Uses reserved huge pages when the system has them and
+     *        falls back to transparent huge pages otherwise.
+     *
+     */
+    struct HugePageStorage
+    {
+        static constexpr size_t huge_page = size_t(2) << 20;
+
+        static void* Acquire(size_t bytes)
+        {
+            bytes = (bytes + huge_page - 1) / huge_page * huge_page;
+
+        #ifdef MAP_HUGETLB
+            void* mem = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+            if (mem != MAP_FAILED) return mem;
+        #endif
+
+            void* pages = MapPages(bytes);
+        #ifdef MADV_HUGEPAGE
+            madvise(pages, bytes, MADV_HUGEPAGE);
+        #endif
+            return pages;
+        }
+
+        static void Release(void* mem, size_t bytes) noexcept
+        {
+            UnmapPages(mem, (bytes + huge_page - 1) / huge_page * huge_page);
+        }
+    };
+}
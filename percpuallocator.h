@@ -0,0 +1,554 @@
+/******************************************************************************/
+/*
+* @file   percpuallocator.h
+* @author Aditya Harsh
+* @brief  Fixed-size allocator with per-CPU caches driven by restartable
+*         sequences (rseq). Linux only; the rseq fast path is x86-64 only and
+*         everything else falls back to a lock-free shared list.
+*/
+/******************************************************************************/
+
+#pragma once
+
+#include <atomic>    /* std::atomic        */
+#include <cstddef>   /* std::ptrdiff_t     */
+#include <cstdint>   /* std::uint32_t      */
+#include <cstdlib>   /* std::abort         */
+#include <cstring>   /* std::memset        */
+#include <new>       /* placement new      */
+#include <stdexcept> /* std::runtime_error */
+
+#include <sys/syscall.h> /* SYS_rseq                   */
+#include <unistd.h>      /* syscall, sysconf           */
+
+#if defined(__x86_64__) && defined(__linux__) && defined(SYS_rseq)
+#define ATL_HAS_RSEQ 1
+#else
+#define ATL_HAS_RSEQ 0
+#endif
+
+#if ATL_HAS_RSEQ && __has_include(<sys/rseq.h>)
+#include <sys/rseq.h> /* __rseq_offset, __rseq_size (glibc 2.35+) */
+#define ATL_GLIBC_RSEQ 1
+#else
+#define ATL_GLIBC_RSEQ 0
+#endif
+
+namespace ATL
+{
+    namespace rseq
+    {
+        // signature preceding abort handlers, same value glibc registers with
+        static constexpr std::uint32_t signature = 0x53053053;
+
+        // kernel ABI (struct rseq), only the fields we touch. The critical
+        // sections below hardcode cpu_id at 4 and rseq_cs at 8.
+        struct alignas(32) Area
+        {
+            std::uint32_t cpu_id_start;
+            std::uint32_t cpu_id;
+            std::uint64_t rseq_cs;
+            std::uint32_t flags;
+        };
+
+        /**
+         * @brief Locates (registering if needed) the calling thread's rseq area
+         *        and returns its offset from the thread pointer. glibc 2.35+
+         *        registers one for every thread; otherwise we register our own.
+         *
+         * @param offset Receives the offset.
+         * @return true rseq is usable on this thread.
+         * @return false Kernel, libc or architecture lacks support.
+         */
+        inline bool ThreadOffset(std::ptrdiff_t& offset) noexcept
+        {
+        #if ATL_HAS_RSEQ
+            thread_local int state = 0; // 0 unknown, 1 usable, -1 unusable
+            thread_local std::ptrdiff_t cached = 0;
+            thread_local Area own = {};
+
+            if (!state)
+            {
+                char* tp = static_cast<char*>(__builtin_thread_pointer());
+                state = -1;
+
+            #if ATL_GLIBC_RSEQ
+                if (__rseq_size)
+                {
+                    cached = __rseq_offset;
+                    state = 1;
+                }
+            #endif
+
+                if (state < 0)
+                {
+                    own.cpu_id = static_cast<std::uint32_t>(-1);
+
+                    if (syscall(SYS_rseq, &own, sizeof(own), 0, signature) == 0)
+                    {
+                        cached = reinterpret_cast<char*>(&own) - tp;
+                        state = 1;
+                    }
+                }
+            }
+
+            offset = cached;
+            return state > 0;
+        #else
+            (void)offset;
+            return false;
+        #endif
+        }
+
+        /**
+         * @brief CPU the thread last started running on.
+         *
+         * @param offset From ThreadOffset.
+         * @return std::uint32_t
+         */
+        inline std::uint32_t CpuStart(std::ptrdiff_t offset) noexcept
+        {
+        #if ATL_HAS_RSEQ
+            const char* tp = static_cast<const char*>(__builtin_thread_pointer());
+            return reinterpret_cast<const volatile Area*>(tp + offset)->cpu_id_start;
+        #else
+            (void)offset;
+            return 0;
+        #endif
+        }
+
+        // outcome of a per-CPU operation
+        enum Result
+        {
+            DONE,
+            EMPTY_OR_FULL,
+            ABORTED
+        };
+
+        /**
+         * @brief Pops the top of a per-CPU stack of pointers, provided the
+         *        thread is still on `cpu` when the count is committed.
+         *
+         * @param offset
+         * @param cpu
+         * @param count Number of entries in slots.
+         * @param slots
+         * @param out Receives the popped pointer.
+         * @return Result
+         */
+        inline Result Pop(std::ptrdiff_t offset, std::uint32_t cpu, std::uintptr_t* count, void** slots, void** out) noexcept
+        {
+        #if ATL_HAS_RSEQ
+            __asm__ __volatile__ goto (
+                ".pushsection __rseq_cs, \"aw\"\n\t"
+                ".balign 32\n\t"
+                "3:\n\t"
+                ".long 0x0, 0x0\n\t"
+                ".quad 1f, (2f - 1f), 4f\n\t"
+                ".popsection\n\t"
+                "leaq 3b(%%rip), %%rax\n\t"
+                "movq %%rax, %%fs:8(%[offset])\n\t"
+                "1:\n\t"
+                "cmpl %[cpu], %%fs:4(%[offset])\n\t"
+                "jnz 4f\n\t"
+                "movq %[count], %%rbx\n\t"
+                "testq %%rbx, %%rbx\n\t"
+                "jz %l[empty]\n\t"
+                "movq -8(%[slots], %%rbx, 8), %%rcx\n\t"
+                "movq %%rcx, %[out]\n\t"
+                "decq %%rbx\n\t"
+                // commit
+                "movq %%rbx, %[count]\n\t"
+                "2:\n\t"
+                ".pushsection __rseq_failure, \"ax\"\n\t"
+                ".byte 0x0f, 0xb9, 0x3d\n\t"
+                ".long 0x53053053\n\t"
+                "4:\n\t"
+                "jmp %l[aborted]\n\t"
+                ".popsection\n\t"
+                :
+                : [offset] "r" (offset), [cpu] "r" (cpu), [count] "m" (*count), [slots] "r" (slots), [out] "m" (*out)
+                : "memory", "cc", "rax", "rbx", "rcx"
+                : empty, aborted
+            );
+            return DONE;
+        empty:
+            return EMPTY_OR_FULL;
+        aborted:
+            return ABORTED;
+        #else
+            (void)offset; (void)cpu; (void)count; (void)slots; (void)out;
+            return EMPTY_OR_FULL;
+        #endif
+        }
+
+        /**
+         * @brief Pushes onto a per-CPU stack of pointers, provided the thread
+         *        is still on `cpu` when the count is committed.
+         *
+         * @param offset
+         * @param cpu
+         * @param count Number of entries in slots.
+         * @param slots
+         * @param capacity Size of slots.
+         * @param ptr
+         * @return Result
+         */
+        inline Result Push(std::ptrdiff_t offset, std::uint32_t cpu, std::uintptr_t* count, void** slots, std::uintptr_t capacity, void* ptr) noexcept
+        {
+        #if ATL_HAS_RSEQ
+            __asm__ __volatile__ goto (
+                ".pushsection __rseq_cs, \"aw\"\n\t"
+                ".balign 32\n\t"
+                "3:\n\t"
+                ".long 0x0, 0x0\n\t"
+                ".quad 1f, (2f - 1f), 4f\n\t"
+                ".popsection\n\t"
+                "leaq 3b(%%rip), %%rax\n\t"
+                "movq %%rax, %%fs:8(%[offset])\n\t"
+                "1:\n\t"
+                "cmpl %[cpu], %%fs:4(%[offset])\n\t"
+                "jnz 4f\n\t"
+                "movq %[count], %%rbx\n\t"
+                "cmpq %[capacity], %%rbx\n\t"
+                "jae %l[full]\n\t"
+                // slot above the count is scratch, harmless if we abort
+                "movq %[ptr], (%[slots], %%rbx, 8)\n\t"
+                "incq %%rbx\n\t"
+                // commit
+                "movq %%rbx, %[count]\n\t"
+                "2:\n\t"
+                ".pushsection __rseq_failure, \"ax\"\n\t"
+                ".byte 0x0f, 0xb9, 0x3d\n\t"
+                ".long 0x53053053\n\t"
+                "4:\n\t"
+                "jmp %l[aborted]\n\t"
+                ".popsection\n\t"
+                :
+                : [offset] "r" (offset), [cpu] "r" (cpu), [count] "m" (*count), [slots] "r" (slots),
+                  [capacity] "r" (capacity), [ptr] "r" (ptr)
+                : "memory", "cc", "rax", "rbx"
+                : full, aborted
+            );
+            return DONE;
+        full:
+            return EMPTY_OR_FULL;
+        aborted:
+            return ABORTED;
+        #else
+            (void)offset; (void)cpu; (void)count; (void)slots; (void)capacity; (void)ptr;
+            return EMPTY_OR_FULL;
+        #endif
+        }
+    }
+
+    /**
+     * @brief Fixed-size allocator with a bounded cache of free blocks per CPU
+     *        (tcmalloc's per-CPU mode). Cache operations are rseq critical
+     *        sections, so they need no atomics and memory does not grow with
+     *        the number of threads. Misses go to a lock-free shared list, which
+     *        is also the only list used when rseq is unavailable. Thread-safe.
+     *
+     *        Blocks parked in one CPU's cache are not visible to the others, so
+     *        size `blocks` with up to cache_capacity blocks per CPU in mind.
+     *
+     * @tparam block_size
+     * @tparam blocks
+     * @tparam cache_capacity Blocks each CPU may hold.
+     */
+    template <size_t block_size, size_t blocks, size_t cache_capacity = 64>
+    class PerCpuMemoryAllocator
+    {
+        // safety checking
+        static_assert(block_size >= 1, "Block size must be at least 1 byte.");
+        static_assert(blocks >= 1, "At least 1 block must be allocated.");
+        static_assert(blocks < 0xFFFFFFFFu, "Shared list indices are 32 bits wide.");
+        static_assert(cache_capacity >= 2, "Per-CPU caches must hold at least 2 blocks.");
+
+        // internal memory type
+        using uchar = unsigned char;
+
+        // byte patterns to mark memory blocks
+        enum Pattern : uchar
+        {
+            UNALLOCATED = 0xAA,
+            ALLOCATED = 0xBB
+        };
+
+        // slot header, link is index + 1 so that 0 means end of list
+        struct Header
+        {
+            std::atomic<std::uint32_t> next;
+        };
+
+        // free blocks held by one CPU, count is only written inside rseq
+        struct alignas(64) CpuCache
+        {
+            std::uintptr_t count;
+            void* slots[cache_capacity];
+        };
+
+        // meta data
+        static constexpr size_t pad_bytes = 2;
+        static constexpr size_t align = alignof(std::max_align_t);
+        static constexpr size_t header_size = (sizeof(Header) + pad_bytes + align - 1) / align * align;
+        static constexpr size_t hb_size = (header_size + block_size + align - 1) / align * align;
+        static constexpr size_t bytes_allocated = hb_size * blocks;
+        static constexpr size_t refill_batch = cache_capacity / 2;
+
+        // internal memory block
+        uchar* data_;
+        // per-CPU caches
+        CpuCache* caches_;
+        size_t cpus_;
+        // shared list head, ABA tag in the upper half
+        alignas(64) std::atomic<std::uint64_t> shared_;
+
+    public:
+
+        /**
+         * @brief Construct a new Per-CPU Memory Allocator object.
+         *
+         */
+        PerCpuMemoryAllocator() : data_(nullptr), caches_(nullptr), cpus_(0), shared_(0)
+        {
+            long cpus = sysconf(_SC_NPROCESSORS_CONF);
+            cpus_ = cpus > 0 ? static_cast<size_t>(cpus) : 1;
+
+            data_ = new uchar[bytes_allocated];
+            caches_ = new CpuCache[cpus_]();
+
+            std::memset(data_, 0, bytes_allocated);
+
+            for (size_t i = blocks; i-- > 0;)
+            {
+                new (data_ + i * hb_size) Header();
+                std::memset(data_ + i * hb_size + header_size - pad_bytes, Pattern::UNALLOCATED, pad_bytes);
+                push_shared(static_cast<std::uint32_t>(i));
+            }
+        }
+
+        /**
+         * @brief Destructor
+         *
+         */
+        ~PerCpuMemoryAllocator() noexcept
+        {
+            delete [] caches_;
+            delete [] data_;
+        }
+
+        /**
+         * @brief Allocates from the current CPU's cache, refilling it from the
+         *        shared list on a miss.
+         *
+         * @return void*
+         */
+        void* Allocate()
+        {
+            void* block = nullptr;
+            std::ptrdiff_t offset = 0;
+
+            if (rseq::ThreadOffset(offset))
+            {
+                for (;;)
+                {
+                    const std::uint32_t cpu = rseq::CpuStart(offset);
+
+                    if (cpu >= cpus_) break;
+
+                    CpuCache& cache = caches_[cpu];
+                    const rseq::Result result = rseq::Pop(offset, cpu, &cache.count, cache.slots, &block);
+
+                    if (result == rseq::DONE) return claim(block);
+                    if (result == rseq::EMPTY_OR_FULL)
+                    {
+                        refill(offset, cpu);
+                        break;
+                    }
+                }
+            }
+
+            block = pop_shared();
+
+            if (!block) throw std::runtime_error("Out of blocks.");
+
+            return claim(block);
+        }
+
+        /**
+         * @brief Frees memory into the current CPU's cache, or the shared list
+         *        when the cache is full.
+         *
+         * @param block
+         */
+        void Free(void* block) noexcept
+        {
+            if (!block) std::abort();
+
+            uchar* memory = reinterpret_cast<uchar*>(block);
+
+            if (memory < data_ + header_size || memory >= data_ + bytes_allocated)
+                std::abort();
+
+            uchar* pad = memory - pad_bytes;
+
+            // safety check
+            for (size_t i = 0; i < pad_bytes; ++i)
+                if (pad[i] != Pattern::ALLOCATED)
+                    std::abort();
+
+            std::memset(pad, Pattern::UNALLOCATED, pad_bytes);
+
+            uchar* slot = memory - header_size;
+            std::ptrdiff_t offset = 0;
+
+            if (rseq::ThreadOffset(offset))
+            {
+                for (;;)
+                {
+                    const std::uint32_t cpu = rseq::CpuStart(offset);
+
+                    if (cpu >= cpus_) break;
+
+                    CpuCache& cache = caches_[cpu];
+                    const rseq::Result result = rseq::Push(offset, cpu, &cache.count, cache.slots, cache_capacity, slot);
+
+                    if (result == rseq::DONE) return;
+                    if (result == rseq::EMPTY_OR_FULL) break;
+                }
+            }
+
+            push_shared(index_of(slot));
+        }
+
+        /**
+         * @brief Whether the calling thread takes the per-CPU fast path.
+         *
+         * @return true
+         * @return false
+         */
+        static bool UsesPerCpuCaches() noexcept
+        {
+            std::ptrdiff_t offset = 0;
+            return rseq::ThreadOffset(offset);
+        }
+
+        // prevent copying of any kind
+        PerCpuMemoryAllocator& operator=(PerCpuMemoryAllocator& rhs) = delete;
+        PerCpuMemoryAllocator(const PerCpuMemoryAllocator& rhs) = delete;
+        PerCpuMemoryAllocator(PerCpuMemoryAllocator&& rhs) = delete;
+
+    private:
+
+        /**
+         * @brief Validates a free slot and hands out its payload.
+         *
+         * @param slot
+         * @return void*
+         */
+        static void* claim(void* slot)
+        {
+            uchar* pad = static_cast<uchar*>(slot) + header_size - pad_bytes;
+
+            // safety check
+            for (size_t i = 0; i < pad_bytes; ++i)
+                if (pad[i] != Pattern::UNALLOCATED)
+                    throw std::runtime_error("Corrupted block detected!");
+
+            std::memset(pad, Pattern::ALLOCATED, pad_bytes);
+
+            return pad + pad_bytes;
+        }
+
+        /**
+         * @brief Moves half a cache worth of blocks from the shared list into
+         *        a CPU's cache. Blocks that no longer fit (we migrated, or
+         *        another thread filled the cache) go straight back.
+         *
+         * @param offset
+         * @param cpu
+         */
+        void refill(std::ptrdiff_t offset, std::uint32_t cpu) noexcept
+        {
+            CpuCache& cache = caches_[cpu];
+
+            for (size_t i = 0; i < refill_batch; ++i)
+            {
+                void* slot = pop_shared();
+
+                if (!slot) return;
+
+                if (rseq::Push(offset, cpu, &cache.count, cache.slots, cache_capacity, slot) != rseq::DONE)
+                {
+                    push_shared(index_of(static_cast<uchar*>(slot)));
+                    return;
+                }
+            }
+        }
+
+        /**
+         * @brief Slot index of a slot address.
+         *
+         * @param slot
+         * @return std::uint32_t
+         */
+        std::uint32_t index_of(const uchar* slot) const noexcept
+        {
+            return static_cast<std::uint32_t>(static_cast<size_t>(slot - data_) / hb_size);
+        }
+
+        /**
+         * @brief Link of a slot.
+         *
+         * @param index
+         * @return std::atomic<std::uint32_t>&
+         */
+        std::atomic<std::uint32_t>& link(std::uint32_t index) const noexcept
+        {
+            return reinterpret_cast<Header*>(data_ + index * hb_size)->next;
+        }
+
+        /**
+         * @brief Pushes into the shared list.
+         *
+         * @param index
+         */
+        void push_shared(std::uint32_t index) noexcept
+        {
+            std::uint64_t head = shared_.load(std::memory_order_relaxed);
+            std::uint64_t next;
+
+            do
+            {
+                link(index).store(static_cast<std::uint32_t>(head), std::memory_order_relaxed);
+                next = ((head >> 32) + 1) << 32 | (index + 1);
+            }
+            while (!shared_.compare_exchange_weak(head, next, std::memory_order_release, std::memory_order_relaxed));
+        }
+
+        /**
+         * @brief Pops from the shared list.
+         *
+         * @return void* Slot address, nullptr when empty.
+         */
+        void* pop_shared() noexcept
+        {
+            std::uint64_t head = shared_.load(std::memory_order_acquire);
+            std::uint64_t next;
+
+            do
+            {
+                const std::uint32_t top = static_cast<std::uint32_t>(head);
+
+                if (!top) return nullptr;
+
+                // the tag makes a stale link harmless, the CAS will fail
+                next = ((head >> 32) + 1) << 32 | link(top - 1).load(std::memory_order_relaxed);
+            }
+            while (!shared_.compare_exchange_weak(head, next, std::memory_order_acquire, std::memory_order_acquire));
+
+            return data_ + (static_cast<std::uint32_t>(head) - 1) * hb_size;
+        }
+    };
+}
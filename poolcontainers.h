@@ -0,0 +1,784 @@
+/******************************************************************************/
+/*
+* @file   poolcontainers.h
+* @author Aditya Harsh
+* @brief  Node-based containers whose nodes live in an embedded TypeAllocator.
+*         Handles are plain node pointers and stay valid until that node is
+*         erased, whatever else happens to the container.
+*/
+/******************************************************************************/
+
+#pragma once
+
+#include "memoryallocator.h" /* ATL::TypeAllocator */
+
+#include <cstddef>     /* std::max_align_t    */
+#include <cstdint>     /* std::uint64_t       */
+#include <functional>  /* std::hash           */
+#include <memory>      /* std::unique_ptr     */
+#include <new>         /* placement new       */
+#include <stdexcept>   /* std::runtime_error  */
+#include <type_traits> /* std::conditional_t  */
+#include <utility>     /* std::forward        */
+
+namespace ATL
+{
+    /**
+     * @brief Doubly linked list holding at most `capacity` elements.
+     *
+     * @tparam T
+     * @tparam capacity
+     */
+    template <typename T, size_t capacity>
+    class PoolList
+    {
+    public:
+
+        // list node, a Handle points at one
+        struct Node
+        {
+            Node* prev;
+            Node* next;
+            T value;
+
+            template <typename... Args>
+            explicit Node(Args&&... args) : prev(nullptr), next(nullptr), value(std::forward<Args>(args)...) {}
+        };
+
+        using Handle = Node*;
+
+        // forward iteration over the values
+        class Iterator
+        {
+            Node* node_;
+
+        public:
+
+            explicit Iterator(Node* node) noexcept : node_(node) {}
+
+            T& operator*() const noexcept { return node_->value; }
+            T* operator->() const noexcept { return &node_->value; }
+            Iterator& operator++() noexcept { node_ = node_->next; return *this; }
+            bool operator==(const Iterator& rhs) const noexcept { return node_ == rhs.node_; }
+            bool operator!=(const Iterator& rhs) const noexcept { return node_ != rhs.node_; }
+        };
+
+    private:
+
+        TypeAllocator<Node, capacity> alloc_;
+        Node* head_;
+        Node* tail_;
+        size_t size_;
+
+    public:
+
+        /**
+         * @brief Construct an empty list.
+         *
+         */
+        PoolList() : alloc_(), head_(nullptr), tail_(nullptr), size_(0) {}
+
+        /**
+         * @brief Destructor
+         *
+         */
+        ~PoolList() noexcept
+        {
+            Clear();
+        }
+
+        /**
+         * @brief Constructs an element at the back.
+         *
+         * @tparam Args
+         * @param args
+         * @return Handle
+         */
+        template <typename... Args>
+        Handle PushBack(Args&&... args)
+        {
+            return link_before(nullptr, alloc_.Allocate(std::forward<Args>(args)...));
+        }
+
+        /**
+         * @brief Constructs an element at the front.
+         *
+         * @tparam Args
+         * @param args
+         * @return Handle
+         */
+        template <typename... Args>
+        Handle PushFront(Args&&... args)
+        {
+            return link_before(head_, alloc_.Allocate(std::forward<Args>(args)...));
+        }
+
+        /**
+         * @brief Constructs an element in front of `pos` (at the back for nullptr).
+         *
+         * @tparam Args
+         * @param pos
+         * @param args
+         * @return Handle
+         */
+        template <typename... Args>
+        Handle InsertBefore(Handle pos, Args&&... args)
+        {
+            return link_before(pos, alloc_.Allocate(std::forward<Args>(args)...));
+        }
+
+        /**
+         * @brief Destroys an element in O(1).
+         *
+         * @param node
+         */
+        void Erase(Handle node) noexcept
+        {
+            (node->prev ? node->prev->next : head_) = node->next;
+            (node->next ? node->next->prev : tail_) = node->prev;
+
+            --size_;
+            alloc_.Free(node);
+        }
+
+        /**
+         * @brief Destroys every element.
+         *
+         */
+        void Clear() noexcept
+        {
+            while (head_)
+                Erase(head_);
+        }
+
+        Handle Front() const noexcept { return head_; }
+        Handle Back() const noexcept { return tail_; }
+        static Handle Next(Handle node) noexcept { return node->next; }
+        static Handle Prev(Handle node) noexcept { return node->prev; }
+
+        size_t Size() const noexcept { return size_; }
+        bool Empty() const noexcept { return !size_; }
+
+        Iterator begin() const noexcept { return Iterator(head_); }
+        Iterator end() const noexcept { return Iterator(nullptr); }
+
+        // prevent copying of any kind
+        PoolList& operator=(PoolList& rhs) = delete;
+        PoolList(const PoolList& rhs) = delete;
+        PoolList(PoolList&& rhs) = delete;
+
+    private:
+
+        /**
+         * @brief Links a fresh node in front of `pos` (at the back for nullptr).
+         *
+         * @param pos
+         * @param node
+         * @return Handle
+         */
+        Handle link_before(Node* pos, Node* node) noexcept
+        {
+            node->next = pos;
+            node->prev = pos ? pos->prev : tail_;
+
+            (node->prev ? node->prev->next : head_) = node;
+            (pos ? pos->prev : tail_) = node;
+
+            ++size_;
+            return node;
+        }
+    };
+
+    /**
+     * @brief Chained hash map holding at most `capacity` entries. The bucket
+     *        array is sized for `capacity` up front, so the map never rehashes
+     *        and entries never move.
+     *
+     * @tparam Key
+     * @tparam Value
+     * @tparam capacity
+     * @tparam Hash
+     * @tparam KeyEqual
+     */
+    template <typename Key, typename Value, size_t capacity, typename Hash = std::hash<Key>, typename KeyEqual = std::equal_to<Key>>
+    class PoolHashMap
+    {
+    public:
+
+        // map entry, a Handle points at one
+        struct Node
+        {
+            Node* next;
+            size_t hash;
+            const Key key;
+            Value value;
+
+            template <typename K, typename... Args>
+            Node(size_t h, K&& k, Args&&... args) : next(nullptr), hash(h), key(std::forward<K>(k)), value(std::forward<Args>(args)...) {}
+        };
+
+        using Handle = Node*;
+
+    private:
+
+        /**
+         * @brief Smallest power of two >= n.
+         *
+         * @param n
+         * @return size_t
+         */
+        static constexpr size_t round_pow2(size_t n) noexcept
+        {
+            size_t pow = 1;
+
+            while (pow < n)
+                pow <<= 1;
+
+            return pow;
+        }
+
+        static constexpr size_t bucket_count = round_pow2(capacity);
+
+        TypeAllocator<Node, capacity> alloc_;
+        std::unique_ptr<Node*[]> buckets_;
+        size_t size_;
+        Hash hash_;
+        KeyEqual equal_;
+
+    public:
+
+        /**
+         * @brief Construct an empty map.
+         *
+         */
+        PoolHashMap() : alloc_(), buckets_(new Node*[bucket_count]()), size_(0), hash_(), equal_() {}
+
+        /**
+         * @brief Destructor
+         *
+         */
+        ~PoolHashMap() noexcept
+        {
+            Clear();
+        }
+
+        /**
+         * @brief Inserts key -> Value(args...) unless the key is present.
+         *
+         * @tparam K
+         * @tparam Args
+         * @param key
+         * @param args
+         * @return std::pair<Handle, bool> The entry for key, and whether it was inserted.
+         */
+        template <typename K, typename... Args>
+        std::pair<Handle, bool> Emplace(K&& key, Args&&... args)
+        {
+            const size_t hash = hash_(key);
+            Node*& bucket = buckets_[hash & (bucket_count - 1)];
+
+            for (Node* node = bucket; node; node = node->next)
+                if (node->hash == hash && equal_(node->key, key))
+                    return {node, false};
+
+            Node* node = alloc_.Allocate(hash, std::forward<K>(key), std::forward<Args>(args)...);
+            node->next = bucket;
+            bucket = node;
+
+            ++size_;
+            return {node, true};
+        }
+
+        /**
+         * @brief Looks up a key.
+         *
+         * @param key
+         * @return Handle nullptr if absent.
+         */
+        Handle Find(const Key& key) const
+        {
+            const size_t hash = hash_(key);
+
+            for (Node* node = buckets_[hash & (bucket_count - 1)]; node; node = node->next)
+                if (node->hash == hash && equal_(node->key, key))
+                    return node;
+
+            return nullptr;
+        }
+
+        /**
+         * @brief Removes a key.
+         *
+         * @param key
+         * @return true
+         * @return false The key was absent.
+         */
+        bool Erase(const Key& key)
+        {
+            Handle node = Find(key);
+
+            if (node) Erase(node);
+
+            return node;
+        }
+
+        /**
+         * @brief Removes an entry, walking only its own bucket.
+         *
+         * @param node
+         */
+        void Erase(Handle node) noexcept
+        {
+            Node** link = &buckets_[node->hash & (bucket_count - 1)];
+
+            while (*link != node)
+                link = &(*link)->next;
+
+            *link = node->next;
+
+            --size_;
+            alloc_.Free(node);
+        }
+
+        /**
+         * @brief Removes every entry.
+         *
+         */
+        void Clear() noexcept
+        {
+            for (size_t i = 0; size_ && i < bucket_count; ++i)
+                while (buckets_[i])
+                    Erase(buckets_[i]);
+        }
+
+        /**
+         * @brief Calls fn(handle) for every entry, in no particular order.
+         *
+         * @tparam Fn
+         * @param fn
+         */
+        template <typename Fn>
+        void ForEach(Fn fn) const
+        {
+            for (size_t i = 0; i < bucket_count; ++i)
+                for (Node* node = buckets_[i]; node; node = node->next)
+                    fn(node);
+        }
+
+        size_t Size() const noexcept { return size_; }
+        bool Empty() const noexcept { return !size_; }
+
+        // prevent copying of any kind
+        PoolHashMap& operator=(PoolHashMap& rhs) = delete;
+        PoolHashMap(const PoolHashMap& rhs) = delete;
+        PoolHashMap(PoolHashMap&& rhs) = delete;
+    };
+
+    namespace detail
+    {
+        /**
+         * @brief Size-class pools for skiplist nodes. Class `links` holds
+         *        nodes with up to `links` forward links, in blocks of
+         *        node_size + links * link_size bytes, and has room for
+         *        capacity / links of them, more than their expected share
+         *        with p = 1/2.
+         *        Classes double up to `max_links`. A node that finds its class
+         *        full is demoted to a smaller one; the single-link class holds
+         *        `capacity` nodes, so an allocation only fails when the
+         *        container is full.
+         *
+         * @tparam node_size
+         * @tparam link_size
+         * @tparam capacity
+         * @tparam links
+         * @tparam max_links
+         */
+        template <size_t node_size, size_t link_size, size_t capacity, size_t links, size_t max_links>
+        class LevelPools
+        {
+            // empty stand-in past the largest class
+            struct None
+            {
+                static void* Allocate(size_t&) noexcept { return nullptr; }
+                static void Free(void*, size_t) noexcept {}
+            };
+
+            static constexpr size_t next_links = links * 2 < max_links ? links * 2 : max_links;
+
+            using Larger = std::conditional_t<(links < max_links), LevelPools<node_size, link_size, capacity, next_links, max_links>, None>;
+
+            MemoryAllocator<node_size + links * link_size, (capacity / links ? capacity / links : 1)> pool_;
+            Larger larger_;
+
+        public:
+
+            /**
+             * @brief Construct the pools of this class and every larger one.
+             *
+             */
+            LevelPools() : pool_(), larger_() {}
+
+            /**
+             * @brief Allocates a node block for `level` links, lowering `level`
+             *        when its class is full.
+             *
+             * @param level
+             * @return void* nullptr when even the smallest class is full.
+             */
+            void* Allocate(size_t& level)
+            {
+                if (level > links)
+                {
+                    if (void* block = larger_.Allocate(level))
+                        return block;
+
+                    level = links;
+                }
+
+                return pool_.CanAllocate() ? pool_.Allocate() : nullptr;
+            }
+
+            /**
+             * @brief Frees a block allocated for `level` links.
+             *
+             * @param block
+             * @param level
+             */
+            void Free(void* block, size_t level) noexcept
+            {
+                if (level > links) larger_.Free(block, level);
+                else pool_.Free(block);
+            }
+
+            // prevent copying of any kind
+            LevelPools& operator=(LevelPools& rhs) = delete;
+            LevelPools(const LevelPools& rhs) = delete;
+            LevelPools(LevelPools&& rhs) = delete;
+        };
+
+        /**
+         * @brief Skiplist forward link. Small trivial keys are copied next to
+         *        the pointer, so a search compares without loading the node
+         *        and only touches the nodes it moves to.
+         *
+         * @tparam Node
+         * @tparam K
+         * @tparam cached
+         */
+        template <typename Node, typename K, bool cached = std::is_trivial<K>::value && sizeof(K) <= sizeof(void*)>
+        struct SkipLink
+        {
+            Node* node;
+            K key;
+
+            void Set(Node* target) noexcept
+            {
+                node = target;
+                key = target->key;
+            }
+
+            const K& Key() const noexcept { return key; }
+        };
+
+        template <typename Node, typename K>
+        struct SkipLink<Node, K, false>
+        {
+            Node* node;
+
+            void Set(Node* target) noexcept
+            {
+                node = target;
+            }
+
+            const K& Key() const noexcept { return node->key; }
+        };
+    }
+
+    /**
+     * @brief Ordered map implemented as a skiplist, holding at most `capacity`
+     *        entries. A node stores only its own forward links, right after
+     *        the key and value, and comes from the size-class pool for its
+     *        level, so most nodes fit in one cache line together with their
+     *        key.
+     *
+     * @tparam Key
+     * @tparam Value
+     * @tparam capacity
+     * @tparam max_level
+     * @tparam Compare
+     */
+    template <typename Key, typename Value, size_t capacity, size_t max_level = 16, typename Compare = std::less<Key>>
+    class PoolSkipList
+    {
+        static_assert(max_level >= 1 && max_level <= 64, "Level count must be between 1 and 64.");
+
+    public:
+
+        // list entry, a Handle points at one; its links follow it in the block
+        struct Node
+        {
+            const Key key;
+            Value value;
+            unsigned char level;
+
+            template <typename K, typename... Args>
+            explicit Node(K&& k, Args&&... args) : key(std::forward<K>(k)), value(std::forward<Args>(args)...), level(1) {}
+        };
+
+        using Handle = Node*;
+
+    private:
+
+        using Link = detail::SkipLink<Node, Key>;
+
+        static constexpr size_t links_offset = (sizeof(Node) + alignof(Link) - 1) / alignof(Link) * alignof(Link);
+
+        static_assert(alignof(Node) <= alignof(std::max_align_t), "Over-aligned entries are not supported.");
+
+        detail::LevelPools<links_offset, sizeof(Link), capacity, 1, max_level> pools_;
+        Link head_[max_level];
+        size_t levels_;
+        size_t size_;
+        std::uint64_t seed_;
+        Compare less_;
+
+    public:
+
+        /**
+         * @brief Construct an empty skiplist.
+         *
+         */
+        PoolSkipList() : pools_(), head_(), levels_(1), size_(0), seed_(0x9E3779B97F4A7C15ull), less_() {}
+
+        /**
+         * @brief Destructor
+         *
+         */
+        ~PoolSkipList() noexcept
+        {
+            Clear();
+        }
+
+        /**
+         * @brief Inserts key -> Value(args...) unless the key is present.
+         *
+         * @tparam K
+         * @tparam Args
+         * @param key
+         * @param args
+         * @return std::pair<Handle, bool> The entry for key, and whether it was inserted.
+         */
+        template <typename K, typename... Args>
+        std::pair<Handle, bool> Emplace(K&& key, Args&&... args)
+        {
+            Link* update[max_level];
+            Node* found = search(key, update);
+
+            if (found && !less_(key, found->key))
+                return {found, false};
+
+            // the size classes hold more than `capacity` nodes in total
+            if (size_ == capacity) throw std::runtime_error("Out of blocks.");
+
+            size_t level = random_level();
+
+            void* block = pools_.Allocate(level);
+            if (!block) throw std::runtime_error("Out of blocks.");
+
+            Node* node;
+
+            try
+            {
+                node = new(block) Node(std::forward<K>(key), std::forward<Args>(args)...);
+            }
+            catch (...)
+            {
+                pools_.Free(block, level);
+                throw;
+            }
+
+            node->level = static_cast<unsigned char>(level);
+
+            for (size_t i = levels_; i < level; ++i)
+                update[i] = &head_[i];
+
+            if (level > levels_) levels_ = level;
+
+            Link* next = links(node);
+
+            for (size_t i = 0; i < level; ++i)
+            {
+                next[i] = *update[i];
+                update[i]->Set(node);
+            }
+
+            ++size_;
+            return {node, true};
+        }
+
+        /**
+         * @brief Looks up a key.
+         *
+         * @param key
+         * @return Handle nullptr if absent.
+         */
+        Handle Find(const Key& key) const
+        {
+            Node* node = LowerBound(key);
+            return node && !less_(key, node->key) ? node : nullptr;
+        }
+
+        /**
+         * @brief First entry whose key is not less than `key`.
+         *
+         * @param key
+         * @return Handle nullptr if there is none.
+         */
+        Handle LowerBound(const Key& key) const
+        {
+            const Link* next = head_;
+            const Node* bound = nullptr;
+
+            for (size_t i = levels_; i-- > 0;)
+            {
+                // a node already found not less than key is not compared again
+                while (next[i].node != bound && less_(next[i].Key(), key))
+                    next = links(next[i].node);
+
+                bound = next[i].node;
+            }
+
+            return next[0].node;
+        }
+
+        /**
+         * @brief Removes a key.
+         *
+         * @param key
+         * @return true
+         * @return false The key was absent.
+         */
+        bool Erase(const Key& key)
+        {
+            Link* update[max_level];
+            Node* node = search(key, update);
+
+            if (!node || less_(key, node->key)) return false;
+
+            Link* next = links(node);
+
+            for (size_t i = 0; i < node->level; ++i)
+                *update[i] = next[i];
+
+            while (levels_ > 1 && !head_[levels_ - 1].node)
+                --levels_;
+
+            --size_;
+            destroy(node);
+            return true;
+        }
+
+        /**
+         * @brief Removes every entry.
+         *
+         */
+        void Clear() noexcept
+        {
+            Node* node = head_[0].node;
+
+            while (node)
+            {
+                Node* next = links(node)[0].node;
+                destroy(node);
+                node = next;
+            }
+
+            for (size_t i = 0; i < max_level; ++i)
+                head_[i] = Link();
+
+            levels_ = 1;
+            size_ = 0;
+        }
+
+        Handle First() const noexcept { return head_[0].node; }
+        static Handle Next(Handle node) noexcept { return links(node)[0].node; }
+
+        size_t Size() const noexcept { return size_; }
+        bool Empty() const noexcept { return !size_; }
+
+        // prevent copying of any kind
+        PoolSkipList& operator=(PoolSkipList& rhs) = delete;
+        PoolSkipList(const PoolSkipList& rhs) = delete;
+        PoolSkipList(PoolSkipList&& rhs) = delete;
+
+    private:
+
+        /**
+         * @brief Forward links of a node, stored right after it.
+         *
+         * @param node
+         * @return Link*
+         */
+        static Link* links(const Node* node) noexcept
+        {
+            return reinterpret_cast<Link*>(reinterpret_cast<std::uintptr_t>(node) + links_offset);
+        }
+
+        /**
+         * @brief Destroys a node and returns its block to its size class.
+         *
+         * @param node
+         */
+        void destroy(Node* node) noexcept
+        {
+            const size_t level = node->level;
+
+            node->~Node();
+            pools_.Free(node, level);
+        }
+
+        /**
+         * @brief Finds, per level, the link that would point at `key`.
+         *
+         * @param key
+         * @param update Receives one link per active level.
+         * @return Node* First node not less than key.
+         */
+        template <typename K>
+        Node* search(const K& key, Link* update[max_level]) noexcept
+        {
+            Link* next = head_;
+            const Node* bound = nullptr;
+
+            for (size_t i = levels_; i-- > 0;)
+            {
+                while (next[i].node != bound && less_(next[i].Key(), key))
+                    next = links(next[i].node);
+
+                bound = next[i].node;
+                update[i] = &next[i];
+            }
+
+            return next[0].node;
+        }
+
+        /**
+         * @brief Geometric level with p = 1/2, from a xorshift generator.
+         *
+         * @return size_t
+         */
+        size_t random_level() noexcept
+        {
+            seed_ ^= seed_ << 13;
+            seed_ ^= seed_ >> 7;
+            seed_ ^= seed_ << 17;
+
+            size_t level = 1;
+
+            for (std::uint64_t bits = seed_; (bits & 1) && level < max_level; bits >>= 1)
+                ++level;
+
+            return level;
+        }
+    };
+}
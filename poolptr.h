@@ -0,0 +1,158 @@
+/******************************************************************************/
+/*
+* @file   poolptr.h
+* @author Aditya Harsh
+* @brief  Smart pointer support for pools with static storage duration.
+*/
+/******************************************************************************/
+
+#pragma once
+
+#include "memoryallocator.h" /* ATL::MemoryAllocator, ATL::TypeAllocator */
+
+#include <cstddef>     /* std::size_t             */
+#include <memory>      /* std::shared_ptr         */
+#include <new>         /* std::bad_alloc          */
+#include <type_traits> /* std::remove_reference_t */
+#include <utility>     /* std::forward            */
+
+namespace ATL
+{
+    /**
+     * @brief std::unique_ptr deleter for a TypeAllocator with static storage
+     *        duration. The pool is part of the type, so the deleter is empty
+     *        and the unique_ptr stays the size of a raw pointer.
+     *
+     * @tparam pool
+     */
+    template <auto& pool>
+    struct StaticPoolDeleter
+    {
+        /**
+         * @brief Destroys and frees an object.
+         *
+         * @tparam T
+         * @param block
+         */
+        template <typename T>
+        void operator()(T* block) const noexcept
+        {
+            pool.Free(block);
+        }
+    };
+
+    /**
+     * @brief Allocates and constructs an object in a static TypeAllocator.
+     *
+     *            static ATL::TypeAllocator<Widget, 128> widgets;
+     *            auto w = ATL::MakeUnique<widgets>(args...);
+     *
+     * @tparam pool
+     * @tparam Args
+     * @param args
+     * @return auto std::unique_ptr<T, StaticPoolDeleter<pool>>
+     */
+    template <auto& pool, typename... Args>
+    auto MakeUnique(Args&&... args)
+    {
+        using T = std::remove_pointer_t<decltype(pool.Allocate(std::forward<Args>(args)...))>;
+        return std::unique_ptr<T, StaticPoolDeleter<pool>>(pool.Allocate(std::forward<Args>(args)...));
+    }
+
+    /**
+     * @brief Block size needed to hold a T together with its shared_ptr
+     *        control block (reference counts, vtable pointer, padding).
+     *
+     * @tparam T
+     */
+    template <typename T>
+    inline constexpr size_t shared_block_size = sizeof(T) + alignof(T) + 4 * sizeof(void*);
+
+    /**
+     * @brief Pool for objects created through allocate_shared.
+     *
+     * @tparam T
+     * @tparam blocks
+     */
+    template <typename T, size_t blocks>
+    using SharedPool = MemoryAllocator<shared_block_size<T>, blocks>;
+
+    /**
+     * @brief Stateless allocator for std::allocate_shared. The library rebinds
+     *        it to its combined control block + object type and allocates that
+     *        once, so both land in a single pool slot and no separate control
+     *        block is allocated. Being empty, it adds nothing to the block.
+     *
+     * @tparam T
+     * @tparam pool A MemoryAllocator (e.g. SharedPool) with static storage duration.
+     */
+    template <typename T, auto& pool>
+    class SharedPoolAllocator
+    {
+    public:
+
+        using value_type = T;
+
+        template <typename U>
+        struct rebind
+        {
+            using other = SharedPoolAllocator<U, pool>;
+        };
+
+        SharedPoolAllocator() noexcept = default;
+
+        template <typename U>
+        SharedPoolAllocator(const SharedPoolAllocator<U, pool>&) noexcept {}
+
+        /**
+         * @brief Allocates one control block. Exhaustion throws
+         *        std::bad_alloc, as the Allocator requirements expect.
+         *
+         * @param n
+         * @return T*
+         */
+        T* allocate(std::size_t n)
+        {
+            static_assert(sizeof(T) <= std::remove_reference_t<decltype(pool)>::BlockSize(), "Control block does not fit in the pool's blocks.");
+            static_assert(alignof(T) <= alignof(std::max_align_t), "Over-aligned types are not supported.");
+
+            if (n != 1 || !pool.CanAllocate()) throw std::bad_alloc();
+
+            return static_cast<T*>(pool.Allocate());
+        }
+
+        /**
+         * @brief Frees one control block.
+         *
+         * @param block
+         */
+        void deallocate(T* block, std::size_t) noexcept
+        {
+            pool.Free(block);
+        }
+
+        template <typename U>
+        bool operator==(const SharedPoolAllocator<U, pool>&) const noexcept { return true; }
+
+        template <typename U>
+        bool operator!=(const SharedPoolAllocator<U, pool>&) const noexcept { return false; }
+    };
+
+    /**
+     * @brief allocate_shared through a static SharedPool.
+     *
+     *            static ATL::SharedPool<Widget, 128> widgets;
+     *            std::shared_ptr<Widget> w = ATL::MakeShared<Widget, widgets>(args...);
+     *
+     * @tparam T
+     * @tparam pool
+     * @tparam Args
+     * @param args
+     * @return std::shared_ptr<T>
+     */
+    template <typename T, auto& pool, typename... Args>
+    std::shared_ptr<T> MakeShared(Args&&... args)
+    {
+        return std::allocate_shared<T>(SharedPoolAllocator<T, pool>(), std::forward<Args>(args)...);
+    }
+}
@@ -0,0 +1,298 @@
+/******************************************************************************/
+/*
+* @file   poolregistry.h
+* @author Aditya Harsh
+* @brief  Maps arbitrary pointers to the pool that owns them.
+*/
+/******************************************************************************/
+
+#pragma once
+
+#include <cstddef>   /* std::size_t        */
+#include <cstdint>   /* std::uintptr_t     */
+#include <cstdlib>   /* std::abort         */
+#include <stdexcept> /* std::runtime_error */
+
+namespace ATL
+{
+    namespace detail
+    {
+        // pointer type a pool's Free takes (void* or T* for TypeAllocator)
+        template <typename Pool, typename Block>
+        Block free_arg(void (Pool::*)(Block) noexcept);
+
+        template <typename Pool, typename Block>
+        Block free_arg(void (Pool::*)(Block));
+    }
+
+    /**
+     * @brief Registry of pools keyed by address. A three level radix page map
+     *        over the 48-bit address space sends any pointer to the pools
+     *        whose arenas touch its 4 KiB page, so finding the owner of a
+     *        pointer takes a fixed number of loads no matter how many pools
+     *        are registered. One generic Free() then works across all of them:
+     *
+     *            ATL::PoolRegistry<> registry;
+     *            registry.Register(small);
+     *            registry.Register(large);
+     *            ...
+     *            if (registry.Owns(p)) registry.Free(p); else delete p;
+     *
+     *        Pools need Owns(), Free(), FromIndex() and BlockCount(), as
+     *        MemoryAllocator and TypeAllocator provide. A page may be shared
+     *        by up to `pools_per_page` arenas. Registration is not
+     *        thread-safe; lookups are read-only and may run concurrently
+     *        with each other.
+     *
+     * @tparam max_pools
+     * @tparam pools_per_page
+     */
+    template <size_t max_pools = 64, size_t pools_per_page = 4>
+    class PoolRegistry
+    {
+        static_assert(max_pools >= 1, "At least 1 pool must be registrable.");
+        static_assert(pools_per_page >= 1, "Pages must hold at least 1 pool.");
+
+        // type erased pool
+        struct Entry
+        {
+            void* pool = nullptr;
+            bool (*owns)(const void* pool, const void* block) = nullptr;
+            void (*free)(void* pool, void* block) = nullptr;
+            std::uintptr_t begin = 0;
+            std::uintptr_t end = 0;
+        };
+
+        // pools touching one page
+        struct Page
+        {
+            Entry* entries[pools_per_page] = {};
+        };
+
+        // address bits per level: 12 + 10 + 13 + 13 = 48
+        static constexpr size_t page_bits = 12;
+        static constexpr size_t leaf_bits = 10;
+        static constexpr size_t mid_bits = 13;
+        static constexpr size_t root_bits = 13;
+
+        struct Leaf
+        {
+            Page pages[size_t(1) << leaf_bits];
+        };
+
+        struct Mid
+        {
+            Leaf* leaves[size_t(1) << mid_bits] = {};
+        };
+
+        Mid* root_[size_t(1) << root_bits];
+        Entry entries_[max_pools];
+
+    public:
+
+        /**
+         * @brief Construct an empty registry.
+         *
+         */
+        PoolRegistry() : root_(), entries_() {}
+
+        /**
+         * @brief Destructor
+         *
+         */
+        ~PoolRegistry() noexcept
+        {
+            for (Mid* mid : root_)
+            {
+                if (!mid) continue;
+
+                for (Leaf* leaf : mid->leaves)
+                    delete leaf;
+
+                delete mid;
+            }
+        }
+
+        /**
+         * @brief Adds a pool. It must stay alive until it is unregistered or
+         *        the registry is destroyed.
+         *
+         * @tparam Pool
+         * @param pool
+         */
+        template <typename Pool>
+        void Register(Pool& pool)
+        {
+            using Block = decltype(detail::free_arg(&Pool::Free));
+
+            Entry* entry = nullptr;
+            for (Entry& e : entries_)
+                if (!e.pool) { entry = &e; break; }
+
+            if (!entry) throw std::runtime_error("Too many pools registered.");
+
+            const std::uintptr_t begin = reinterpret_cast<std::uintptr_t>(pool.FromIndex(0));
+            const std::uintptr_t end = reinterpret_cast<std::uintptr_t>(pool.FromIndex(Pool::BlockCount() - 1)) + Pool::BlockSize();
+
+            // make sure every page has room before touching any of them
+            for (std::uintptr_t page = begin >> page_bits; page <= (end - 1) >> page_bits; ++page)
+            {
+                Page& p = page_of(page);
+                if (p.entries[pools_per_page - 1]) throw std::runtime_error("Too many pools share a page.");
+            }
+
+            entry->pool = &pool;
+            entry->owns = [](const void* self, const void* block) { return static_cast<const Pool*>(self)->Owns(block); };
+            entry->free = [](void* self, void* block) { static_cast<Pool*>(self)->Free(static_cast<Block>(block)); };
+            entry->begin = begin;
+            entry->end = end;
+
+            for (std::uintptr_t page = begin >> page_bits; page <= (end - 1) >> page_bits; ++page)
+            {
+                Page& p = page_of(page);
+
+                for (Entry*& slot : p.entries)
+                    if (!slot) { slot = entry; break; }
+            }
+        }
+
+        /**
+         * @brief Removes a pool.
+         *
+         * @tparam Pool
+         * @param pool
+         */
+        template <typename Pool>
+        void Unregister(Pool& pool) noexcept
+        {
+            for (Entry& entry : entries_)
+            {
+                if (entry.pool != &pool) continue;
+
+                for (std::uintptr_t page = entry.begin >> page_bits; page <= (entry.end - 1) >> page_bits; ++page)
+                {
+                    Page* p = find_page(page);
+                    if (!p) continue;
+
+                    // keep the page's entries packed at the front
+                    size_t i = 0;
+                    for (size_t j = 0; j < pools_per_page; ++j)
+                        if (p->entries[j] != &entry)
+                            p->entries[i++] = p->entries[j];
+
+                    while (i < pools_per_page)
+                        p->entries[i++] = nullptr;
+                }
+
+                entry = Entry();
+                return;
+            }
+        }
+
+        /**
+         * @brief The registered pool a block came from, nullptr for anything
+         *        else (heap memory, interior pointers, stack addresses...).
+         *
+         * @param block
+         * @return void*
+         */
+        void* Owner(const void* block) const noexcept
+        {
+            const Entry* entry = find(block);
+            return entry ? entry->pool : nullptr;
+        }
+
+        /**
+         * @brief Whether a block came from a registered pool.
+         *
+         * @param block
+         * @return true
+         * @return false
+         */
+        bool Owns(const void* block) const noexcept
+        {
+            return find(block);
+        }
+
+        /**
+         * @brief Returns a block to whichever registered pool it came from.
+         *        Aborts on pointers no registered pool owns.
+         *
+         * @param block
+         */
+        void Free(void* block) noexcept
+        {
+            const Entry* entry = find(block);
+
+            // safety check
+            if (!entry) std::abort();
+
+            entry->free(entry->pool, block);
+        }
+
+        // prevent copying of any kind
+        PoolRegistry& operator=(PoolRegistry& rhs) = delete;
+        PoolRegistry(const PoolRegistry& rhs) = delete;
+        PoolRegistry(PoolRegistry&& rhs) = delete;
+
+    private:
+
+        /**
+         * @brief Entry of the pool owning a block, if any.
+         *
+         * @param block
+         * @return const Entry*
+         */
+        const Entry* find(const void* block) const noexcept
+        {
+            const Page* p = find_page(reinterpret_cast<std::uintptr_t>(block) >> page_bits);
+            if (!p) return nullptr;
+
+            for (const Entry* entry : p->entries)
+            {
+                if (!entry) break;
+                if (entry->owns(entry->pool, block)) return entry;
+            }
+
+            return nullptr;
+        }
+
+        /**
+         * @brief Looks up a page without creating anything.
+         *
+         * @param page Address >> page_bits.
+         * @return Page*
+         */
+        Page* find_page(std::uintptr_t page) const noexcept
+        {
+            if (page >> (leaf_bits + mid_bits + root_bits)) return nullptr;
+
+            Mid* mid = root_[page >> (leaf_bits + mid_bits)];
+            if (!mid) return nullptr;
+
+            Leaf* leaf = mid->leaves[(page >> leaf_bits) & ((size_t(1) << mid_bits) - 1)];
+            if (!leaf) return nullptr;
+
+            return &leaf->pages[page & ((size_t(1) << leaf_bits) - 1)];
+        }
+
+        /**
+         * @brief Looks up a page, creating the levels leading to it.
+         *
+         * @param page Address >> page_bits.
+         * @return Page&
+         */
+        Page& page_of(std::uintptr_t page)
+        {
+            if (page >> (leaf_bits + mid_bits + root_bits)) throw std::runtime_error("Address outside the page map.");
+
+            Mid*& mid = root_[page >> (leaf_bits + mid_bits)];
+            if (!mid) mid = new Mid();
+
+            Leaf*& leaf = mid->leaves[(page >> leaf_bits) & ((size_t(1) << mid_bits) - 1)];
+            if (!leaf) leaf = new Leaf();
+
+            return leaf->pages[page & ((size_t(1) << leaf_bits) - 1)];
+        }
+    };
+}
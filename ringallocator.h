@@ -0,0 +1,241 @@
+/******************************************************************************/
+/*
+* @file   ringallocator.h
+* @author Aditya Harsh
+* @brief  Lock-free ring-buffer allocator for variable-length messages freed
+*         in FIFO order.
+*/
+/******************************************************************************/
+
+#pragma once
+
+#include <atomic>    /* std::atomic        */
+#include <cstddef>   /* std::size_t        */
+#include <cstdint>   /* std::uint64_t      */
+#include <cstring>   /* std::memset        */
+#include <memory>    /* std::unique_ptr    */
+#include <stdexcept> /* std::runtime_error */
+#include <thread>    /* std::this_thread   */
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h> /* _mm_pause */
+#endif
+
+namespace ATL
+{
+    /**
+     * @brief Streaming allocator over a ring of `capacity` bytes, for
+     *        messages that producers write and one consumer frees in the
+     *        order they were allocated. Producers claim space with a single
+     *        fetch_add on the tail, write the message and Commit() it; the
+     *        consumer Peek()s the oldest message once committed and
+     *        Release()s it. Messages are packed back to back, so there is no
+     *        fragmentation and the consumer reads memory sequentially.
+     *
+     *        Any number of producer threads (MPSC), one consumer thread.
+     *        Producers spin, then yield, while the ring is full. Each message
+     *        carries an 8 byte header and payloads are 8-byte aligned.
+     *
+     * @tparam capacity Ring size in bytes, a power of two.
+     */
+    template <size_t capacity>
+    class RingAllocator
+    {
+        // safety checking
+        static_assert(capacity >= 64 && (capacity & (capacity - 1)) == 0, "Capacity must be a power of two, at least 64.");
+        static_assert(capacity <= (size_t(1) << 32), "Capacity too large for the record header.");
+
+        // internal memory type
+        using uchar = unsigned char;
+        using Header = std::atomic<std::uint64_t>;
+
+        static_assert(sizeof(Header) == 8 && Header::is_always_lock_free, "Record headers must be lock-free words.");
+
+        // record header: payload bytes in the low 32 bits, then flags
+        static constexpr std::uint64_t COMMITTED = std::uint64_t(1) << 32;
+        static constexpr std::uint64_t PADDING = std::uint64_t(1) << 33;
+        static constexpr std::uint64_t SIZE_MASK = COMMITTED - 1;
+
+        static constexpr size_t header_size = sizeof(Header);
+        static constexpr size_t align = 8;
+
+        // ring, zero wherever no record is live
+        std::unique_ptr<uchar[]> data_;
+        // next position to claim, shared by producers
+        alignas(64) std::atomic<std::uint64_t> tail_;
+        // oldest live position, written by the consumer only
+        alignas(64) std::atomic<std::uint64_t> head_;
+
+    public:
+
+        /**
+         * @brief Construct a new Ring Allocator object.
+         *
+         */
+        RingAllocator() : data_(new uchar[capacity]()), tail_(0), head_(0) {}
+
+        /**
+         * @brief Claims `size` bytes at the end of the ring, waiting for the
+         *        consumer if the ring is full. The message is invisible to the
+         *        consumer until Commit().
+         *
+         * @param size
+         * @return void*
+         */
+        void* Allocate(size_t size)
+        {
+            const size_t total = record_size(size);
+
+            if (total > capacity) throw std::runtime_error("Message larger than the ring.");
+
+            for (;;)
+            {
+                const std::uint64_t pos = tail_.fetch_add(total, std::memory_order_relaxed);
+                const size_t offset = static_cast<size_t>(pos & (capacity - 1));
+
+                wait_for_space(pos + total);
+
+                if (offset + total <= capacity)
+                {
+                    header_at(offset).store(size, std::memory_order_relaxed);
+                    return data_.get() + offset + header_size;
+                }
+
+                // the claim wraps: turn both halves into padding and retry
+                const size_t first = capacity - offset;
+                header_at(offset).store((first - header_size) | PADDING | COMMITTED, std::memory_order_release);
+                header_at(0).store((total - first - header_size) | PADDING | COMMITTED, std::memory_order_release);
+            }
+        }
+
+        /**
+         * @brief Publishes a message to the consumer. Called once by the
+         *        producer that allocated it, after writing it.
+         *
+         * @param block
+         */
+        void Commit(void* block) noexcept
+        {
+            Header& header = *reinterpret_cast<Header*>(static_cast<uchar*>(block) - header_size);
+            header.store(header.load(std::memory_order_relaxed) | COMMITTED, std::memory_order_release);
+        }
+
+        /**
+         * @brief Oldest message, if it has been committed. Consumer only.
+         *
+         * @param size Set to the message's size.
+         * @return void* nullptr if the oldest message is not committed yet.
+         */
+        void* Peek(size_t& size) noexcept
+        {
+            for (;;)
+            {
+                const std::uint64_t head = head_.load(std::memory_order_relaxed);
+                const size_t offset = static_cast<size_t>(head & (capacity - 1));
+                const std::uint64_t header = header_at(offset).load(std::memory_order_acquire);
+
+                if (!(header & COMMITTED)) return nullptr;
+
+                if (header & PADDING)
+                {
+                    release_at(head, header);
+                    continue;
+                }
+
+                size = static_cast<size_t>(header & SIZE_MASK);
+                return data_.get() + offset + header_size;
+            }
+        }
+
+        /**
+         * @brief Frees the message returned by the last Peek(). Consumer only.
+         *
+         */
+        void Release() noexcept
+        {
+            const std::uint64_t head = head_.load(std::memory_order_relaxed);
+            release_at(head, header_at(static_cast<size_t>(head & (capacity - 1))).load(std::memory_order_relaxed));
+        }
+
+        /**
+         * @brief Largest message that fits.
+         *
+         * @return size_t
+         */
+        static constexpr size_t MaxMessageSize() noexcept
+        {
+            return capacity - header_size;
+        }
+
+        // prevent copying of any kind
+        RingAllocator& operator=(RingAllocator& rhs) = delete;
+        RingAllocator(const RingAllocator& rhs) = delete;
+        RingAllocator(RingAllocator&& rhs) = delete;
+
+    private:
+
+        /**
+         * @brief Bytes a message occupies, header included.
+         *
+         * @param size
+         * @return size_t
+         */
+        static constexpr size_t record_size(size_t size) noexcept
+        {
+            return header_size + (size + align - 1) / align * align;
+        }
+
+        /**
+         * @brief Header of the record starting at an offset.
+         *
+         * @param offset
+         * @return Header&
+         */
+        Header& header_at(size_t offset) const noexcept
+        {
+            return *reinterpret_cast<Header*>(data_.get() + offset);
+        }
+
+        /**
+         * @brief Zeroes the record at the head and hands its bytes back to
+         *        the producers.
+         *
+         * @param head
+         * @param header
+         */
+        void release_at(std::uint64_t head, std::uint64_t header) noexcept
+        {
+            const size_t total = record_size(static_cast<size_t>(header & SIZE_MASK));
+
+            // a zero header is what marks a record as not yet committed
+            std::memset(data_.get() + (head & (capacity - 1)), 0, total);
+
+            head_.store(head + total, std::memory_order_release);
+        }
+
+        /**
+         * @brief Spins until the consumer has released everything below
+         *        `end - capacity`.
+         *
+         * @param end
+         */
+        void wait_for_space(std::uint64_t end) const noexcept
+        {
+            for (unsigned spins = 0; end - head_.load(std::memory_order_acquire) > capacity; ++spins)
+            {
+                // give the consumer the core if it is not running
+                if (spins >= 64)
+                {
+                    std::this_thread::yield();
+                    continue;
+                }
+
+            #if defined(__x86_64__) || defined(__i386__)
+                _mm_pause();
+            #elif defined(__aarch64__)
+                asm volatile("yield" ::: "memory");
+            #endif
+            }
+        }
+    };
+}
@@ -0,0 +1,156 @@
+/******************************************************************************/
+/*
+* @file   sanitizers.h
+* @author Aditya Harsh
+* @brief  AddressSanitizer / Valgrind annotations for sub-allocated memory.
+*         Everything expands to nothing unless a tool is present:
+*         - ASan: automatic when compiled with -fsanitize=address.
+*         - Valgrind: automatic in non-NDEBUG builds when <valgrind/memcheck.h>
+*           is available, or forced with ATL_VALGRIND.
+*/
+/******************************************************************************/
+
+#pragma once
+
+#include <cstddef> /* std::size_t */
+
+#if defined(__SANITIZE_ADDRESS__)
+#define ATL_ASAN 1
+#elif defined(__has_feature)
+#if __has_feature(address_sanitizer)
+#define ATL_ASAN 1
+#endif
+#endif
+
+#ifndef ATL_ASAN
+#define ATL_ASAN 0
+#endif
+
+#if !defined(ATL_VALGRIND) && !defined(NDEBUG) && __has_include(<valgrind/memcheck.h>)
+#define ATL_VALGRIND 1
+#endif
+
+#ifndef ATL_VALGRIND
+#define ATL_VALGRIND 0
+#endif
+
+#if ATL_ASAN
+#include <sanitizer/asan_interface.h> /* ASAN_POISON_MEMORY_REGION */
+#endif
+
+#if ATL_VALGRIND
+#include <valgrind/memcheck.h> /* VALGRIND_MEMPOOL_* */
+#endif
+
+namespace ATL
+{
+    namespace sanitizer
+    {
+        /**
+         * @brief Registers a pool's arena; the whole arena starts inaccessible.
+         *
+         * @param base
+         * @param size
+         */
+        inline void PoolCreate(const void* base, std::size_t size) noexcept
+        {
+        #if ATL_ASAN
+            ASAN_POISON_MEMORY_REGION(base, size);
+        #endif
+        #if ATL_VALGRIND
+            VALGRIND_CREATE_MEMPOOL(base, 0, 0);
+            VALGRIND_MAKE_MEM_NOACCESS(base, size);
+        #endif
+            (void)base; (void)size;
+        }
+
+        /**
+         * @brief Unregisters a pool's arena before it is released.
+         *
+         * @param base
+         * @param size
+         */
+        inline void PoolDestroy(const void* base, std::size_t size) noexcept
+        {
+        #if ATL_ASAN
+            ASAN_UNPOISON_MEMORY_REGION(base, size);
+        #endif
+        #if ATL_VALGRIND
+            VALGRIND_DESTROY_MEMPOOL(base);
+            VALGRIND_MAKE_MEM_UNDEFINED(base, size);
+        #endif
+            (void)base; (void)size;
+        }
+
+        /**
+         * @brief Marks a block as handed out to the user.
+         *
+         * @param base Arena the block belongs to.
+         * @param block
+         * @param size Usable bytes; anything past it stays inaccessible.
+         */
+        inline void BlockAllocated(const void* base, const void* block, std::size_t size) noexcept
+        {
+        #if ATL_ASAN
+            ASAN_UNPOISON_MEMORY_REGION(block, size);
+        #endif
+        #if ATL_VALGRIND
+            VALGRIND_MEMPOOL_ALLOC(base, block, size);
+        #endif
+            (void)base; (void)block; (void)size;
+        }
+
+        /**
+         * @brief Marks a block as returned to the pool.
+         *
+         * @param base Arena the block belongs to.
+         * @param block
+         * @param size Bytes to make inaccessible.
+         */
+        inline void BlockFreed(const void* base, const void* block, std::size_t size) noexcept
+        {
+        #if ATL_ASAN
+            ASAN_POISON_MEMORY_REGION(block, size);
+        #endif
+        #if ATL_VALGRIND
+            VALGRIND_MEMPOOL_FREE(base, block);
+        #endif
+            (void)base; (void)block; (void)size;
+        }
+
+        /**
+         * @brief Opens allocator-private memory (links, guard bytes) for the
+         *        allocator's own access.
+         *
+         * @param mem
+         * @param size
+         */
+        inline void Open(const void* mem, std::size_t size) noexcept
+        {
+        #if ATL_ASAN
+            ASAN_UNPOISON_MEMORY_REGION(mem, size);
+        #endif
+        #if ATL_VALGRIND
+            VALGRIND_MAKE_MEM_DEFINED(mem, size);
+        #endif
+            (void)mem; (void)size;
+        }
+
+        /**
+         * @brief Closes allocator-private memory again.
+         *
+         * @param mem
+         * @param size
+         */
+        inline void Close(const void* mem, std::size_t size) noexcept
+        {
+        #if ATL_ASAN
+            ASAN_POISON_MEMORY_REGION(mem, size);
+        #endif
+        #if ATL_VALGRIND
+            VALGRIND_MAKE_MEM_NOACCESS(mem, size);
+        #endif
+            (void)mem; (void)size;
+        }
+    }
+}
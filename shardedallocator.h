@@ -0,0 +1,233 @@
+/******************************************************************************/
+/*
+* @file   shardedallocator.h
+* @author Aditya Harsh
+* @brief  Fixed-size allocator split into independently locked shards.
+*/
+/******************************************************************************/
+
+#pragma once
+
+#include "spinlock.h" /* ATL::SpinLock */
+
+#include <cstddef>    /* std::max_align_t   */
+#include <cstdlib>    /* std::abort         */
+#include <cstring>    /* std::memset        */
+#include <functional> /* std::hash          */
+#include <mutex>      /* std::lock_guard    */
+#include <stdexcept>  /* std::runtime_error */
+#include <thread>     /* std::this_thread   */
+
+namespace ATL
+{
+    /**
+     * @brief Hash of the calling thread's id, computed once per thread.
+     *
+     * @return size_t
+     */
+    inline size_t ThreadHash() noexcept
+    {
+        thread_local const size_t hash = std::hash<std::thread::id>()(std::this_thread::get_id());
+        return hash;
+    }
+
+    /**
+     * @brief Fixed-size allocator whose free blocks are spread over several
+     *        free lists, each behind its own spinlock on its own cache line.
+     *        Threads pick a shard by hashing their id, free into that same
+     *        shard, and steal from the others only when it runs dry, so lock
+     *        contention falls roughly with the shard count. Thread-safe.
+     *
+     * @tparam block_size
+     * @tparam blocks
+     * @tparam shards
+     */
+    template <size_t block_size, size_t blocks, size_t shards>
+    class ShardedMemoryAllocator
+    {
+        // safety checking
+        static_assert(block_size >= 1, "Block size must be at least 1 byte.");
+        static_assert(blocks >= 1, "At least 1 block must be allocated.");
+        static_assert(shards >= 1 && shards <= blocks, "Need between 1 and `blocks` shards.");
+
+        // internal memory type
+        using uchar = unsigned char;
+
+        // byte patterns to mark memory blocks
+        enum Pattern : uchar
+        {
+            UNALLOCATED = 0xAA,
+            ALLOCATED = 0xBB
+        };
+
+        // represents a list object
+        struct List
+        {
+            List* next = nullptr;
+        };
+
+        // one striped head, kept on its own cache line
+        struct alignas(64) Shard
+        {
+            SpinLock lock{};
+            List* free_list = nullptr;
+        };
+
+        // meta data
+        static constexpr size_t pad_bytes = 2;
+        static constexpr size_t align = alignof(std::max_align_t);
+        static constexpr size_t header_size = (sizeof(List) + pad_bytes + align - 1) / align * align;
+        static constexpr size_t hb_size = (header_size + block_size + align - 1) / align * align;
+        static constexpr size_t bytes_allocated = hb_size * blocks;
+
+        // internal memory block
+        uchar* data_;
+        // striped free lists
+        Shard shards_[shards];
+
+    public:
+
+        /**
+         * @brief Construct a new Sharded Memory Allocator object. Each shard
+         *        starts with a contiguous run of blocks.
+         *
+         */
+        ShardedMemoryAllocator() : data_(nullptr), shards_()
+        {
+            data_ = new uchar[bytes_allocated];
+
+            std::memset(data_, 0, bytes_allocated);
+
+            for (size_t i = blocks; i-- > 0;)
+            {
+                uchar* slot = data_ + i * hb_size;
+                std::memset(slot + header_size - pad_bytes, Pattern::UNALLOCATED, pad_bytes);
+                push_list(shards_[i * shards / blocks], reinterpret_cast<List*>(slot));
+            }
+        }
+
+        /**
+         * @brief Destructor
+         *
+         */
+        ~ShardedMemoryAllocator() noexcept
+        {
+            delete [] data_;
+        }
+
+        /**
+         * @brief Allocates from the caller's shard, stealing from the next
+         *        non-empty shard when it is exhausted.
+         *
+         * @return void*
+         */
+        void* Allocate()
+        {
+            void* memory = TryAllocate();
+
+            if (!memory) throw std::runtime_error("Out of blocks.");
+
+            return memory;
+        }
+
+        /**
+         * @brief Same as Allocate(), but reports exhaustion with nullptr.
+         *
+         * @return void*
+         */
+        void* TryAllocate()
+        {
+            const size_t home = ThreadHash() % shards;
+
+            for (size_t i = 0; i < shards; ++i)
+            {
+                Shard& shard = shards_[(home + i) % shards];
+                std::lock_guard<SpinLock> guard(shard.lock);
+
+                if (!shard.free_list) continue;
+
+                uchar* memory = reinterpret_cast<uchar*>(shard.free_list) + header_size;
+                uchar* pad = memory - pad_bytes;
+
+                // safety check
+                for (size_t j = 0; j < pad_bytes; ++j)
+                    if (pad[j] != Pattern::UNALLOCATED)
+                        throw std::runtime_error("Corrupted block detected!");
+
+                shard.free_list = shard.free_list->next;
+
+                std::memset(pad, Pattern::ALLOCATED, pad_bytes);
+
+                return memory;
+            }
+
+            return nullptr;
+        }
+
+        /**
+         * @brief Frees memory into the caller's shard.
+         *
+         * @param block
+         */
+        void Free(void* block) noexcept
+        {
+            if (!block) std::abort();
+
+            uchar* memory = reinterpret_cast<uchar*>(block);
+
+            if (memory < data_ + header_size || memory >= data_ + bytes_allocated)
+                std::abort();
+
+            uchar* pad = memory - pad_bytes;
+
+            // safety check
+            for (size_t i = 0; i < pad_bytes; ++i)
+                if (pad[i] != Pattern::ALLOCATED)
+                    std::abort();
+
+            std::memset(pad, Pattern::UNALLOCATED, pad_bytes);
+
+            Shard& shard = shards_[ThreadHash() % shards];
+            std::lock_guard<SpinLock> guard(shard.lock);
+
+            push_list(shard, reinterpret_cast<List*>(memory - header_size));
+        }
+
+        /**
+         * @brief Whether a pointer is the start of a block in this
+         *        allocator's arena. Interior pointers are rejected, as by
+         *        MemoryAllocator::Owns. O(1).
+         *
+         * @param block
+         * @return true
+         * @return false
+         */
+        bool Owns(const void* block) const noexcept
+        {
+            const uchar* memory = static_cast<const uchar*>(block);
+
+            if (memory < data_ + header_size || memory >= data_ + bytes_allocated) return false;
+
+            return static_cast<size_t>(memory - data_ - header_size) % hb_size == 0;
+        }
+
+        // prevent copying of any kind
+        ShardedMemoryAllocator& operator=(ShardedMemoryAllocator& rhs) = delete;
+        ShardedMemoryAllocator(const ShardedMemoryAllocator& rhs) = delete;
+        ShardedMemoryAllocator(ShardedMemoryAllocator&& rhs) = delete;
+
+    private:
+
+        /**
+         * @brief Pushes into a shard's list.
+         *
+         * @param shard
+         * @param list
+         */
+        static void push_list(Shard& shard, List* list) noexcept
+        {
+            list->next = shard.free_list;
+            shard.free_list = list;
+        }
+    };
+}
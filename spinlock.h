@@ -0,0 +1,94 @@
+/******************************************************************************/
+/*
+* @file   spinlock.h
+* @author Aditya Harsh
+* @brief  Tiny test-and-test-and-set spinlock used by the concurrent pools.
+*/
+/******************************************************************************/
+
+#pragma once
+
+#include <atomic> /* std::atomic */
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h> /* _mm_pause */
+#endif
+
+namespace ATL
+{
+    /**
+     * @brief Spinlock meant for critical sections of a handful of instructions.
+     *        Satisfies Lockable, so it works with std::lock_guard.
+     *
+     */
+    class SpinLock
+    {
+        std::atomic<bool> locked_;
+
+    public:
+
+        /**
+         * @brief Construct an unlocked spinlock.
+         *
+         */
+        SpinLock() noexcept : locked_(false) {}
+
+        /**
+         * @brief Spins until the lock is acquired.
+         *
+         */
+        void lock() noexcept
+        {
+            for (;;)
+            {
+                if (!locked_.exchange(true, std::memory_order_acquire))
+                    return;
+
+                // wait on a plain load so the cache line stays shared
+                while (locked_.load(std::memory_order_relaxed))
+                    relax();
+            }
+        }
+
+        /**
+         * @brief Attempts to acquire the lock without spinning.
+         *
+         * @return true
+         * @return false
+         */
+        bool try_lock() noexcept
+        {
+            return !locked_.load(std::memory_order_relaxed) &&
+                   !locked_.exchange(true, std::memory_order_acquire);
+        }
+
+        /**
+         * @brief Releases the lock.
+         *
+         */
+        void unlock() noexcept
+        {
+            locked_.store(false, std::memory_order_release);
+        }
+
+        // prevent copying of any kind
+        SpinLock& operator=(SpinLock& rhs) = delete;
+        SpinLock(const SpinLock& rhs) = delete;
+        SpinLock(SpinLock&& rhs) = delete;
+
+    private:
+
+        /**
+         * @brief Hints the CPU that we are busy-waiting.
+         *
+         */
+        static void relax() noexcept
+        {
+        #if defined(__x86_64__) || defined(__i386__)
+            _mm_pause();
+        #elif defined(__aarch64__)
+            asm volatile("yield" ::: "memory");
+        #endif
+        }
+    };
+}
@@ -0,0 +1,239 @@
+/******************************************************************************/
+/*
+* @file   staticallocator.h
+* @author Aditya Harsh
+* @brief  Fixed-size allocator with inline storage and no heap allocation.
+*/
+/******************************************************************************/
+
+#pragma once
+
+#include "memoryallocator.h" /* ATL::detail::LinkType */
+
+#include <cstddef>     /* std::max_align_t   */
+#include <cstdlib>     /* std::abort         */
+#include <cstring>     /* std::memset        */
+#include <stdexcept>   /* std::runtime_error */
+#include <type_traits> /* std::is_pointer    */
+
+namespace ATL
+{
+    /**
+     * @brief MemoryAllocator variant that keeps its arena inside the object.
+     *        Nothing is allocated from the heap, block addresses are a fixed
+     *        offset from `this`, and the constexpr constructor sets two
+     *        members and leaves the arena untouched, so construction is O(1)
+     *        wherever the object lives and a static instance is
+     *        constant-initialized into .bss. The free list is built lazily:
+     *        slots that were never used are handed out by bumping an index,
+     *        and only freed slots are linked.
+     *
+     *        Only the guard bytes are checked. There is no Policy (debug
+     *        quarantine and poisoning), no occupancy bitmap or
+     *        ForEachAllocated, and no ASan/Valgrind annotations; use
+     *        MemoryAllocator when those matter.
+     *
+     *            static ATL::StaticMemoryAllocator<64, 1024> pool; // no code runs at startup
+     *
+     * @tparam block_size
+     * @tparam blocks
+     */
+    template <size_t block_size, size_t blocks>
+    class StaticMemoryAllocator
+    {
+        // safety checking
+        static_assert(block_size >= 1, "Block size must be at least 1 byte.");
+        static_assert(blocks >= 1, "At least 1 block must be allocated.");
+
+        // internal memory type
+        using uchar = unsigned char;
+
+        // byte patterns to mark memory blocks
+        enum Pattern : uchar
+        {
+            UNALLOCATED = 0xAA,
+            ALLOCATED = 0xBB
+        };
+
+        // free-list link, sized by the number of blocks as in MemoryAllocator
+        using Link = detail::LinkType<blocks>;
+
+        // represents a list object
+        struct List
+        {
+            Link next;
+        };
+
+        // meta data, header and stride are rounded so every block is
+        // suitably aligned for any type that fits in it: fundamental
+        // alignment, or less for blocks smaller than that
+        static constexpr size_t pad_bytes = 2;
+        static constexpr size_t align = block_size < alignof(std::max_align_t) ? detail::BitFloor(block_size) : alignof(std::max_align_t);
+        static constexpr size_t header_size = (sizeof(Link) + pad_bytes + align - 1) / align * align;
+        static constexpr size_t hb_size = (header_size + block_size + align - 1) / align * align;
+        static constexpr size_t bytes_allocated = hb_size * blocks;
+
+        // inline arena; the union lets the constexpr constructor leave the
+        // bytes uninitialized instead of zeroing them
+        union Arena
+        {
+            char unused;
+            alignas(std::max_align_t) uchar bytes[bytes_allocated];
+
+            constexpr Arena() noexcept : unused() {}
+        };
+
+        Arena data_;
+        // freed blocks
+        List* free_list_;
+        // slots below this have been handed out at least once
+        size_t bump_;
+
+    public:
+
+        /**
+         * @brief Construct a new Static Memory Allocator object. O(1).
+         *
+         */
+        constexpr StaticMemoryAllocator() noexcept : data_(), free_list_(nullptr), bump_(0) {}
+
+        /**
+         * @brief Allocates memory with O(1) performance.
+         *
+         * @return void*
+         */
+        void* Allocate()
+        {
+            uchar* memory;
+
+            if (free_list_)
+            {
+                memory = reinterpret_cast<uchar*>(free_list_) + header_size - pad_bytes;
+
+                // safety check
+                for (size_t i = 0; i < pad_bytes; ++i)
+                    if (memory[i] != Pattern::UNALLOCATED)
+                        throw std::runtime_error("Corrupted block detected!");
+
+                free_list_ = next_of(free_list_);
+            }
+            else if (bump_ < blocks)
+            {
+                // never used, so the header holds whatever was there before
+                memory = data_.bytes + bump_++ * hb_size + header_size - pad_bytes;
+            }
+            else
+            {
+                throw std::runtime_error("Out of blocks.");
+            }
+
+            std::memset(memory, Pattern::ALLOCATED, pad_bytes);
+
+            return memory + pad_bytes;
+        }
+
+        /**
+         * @brief Frees memory.
+         *
+         * @param block
+         */
+        void Free(void* block) noexcept
+        {
+            if (!block) std::abort();
+
+            uchar* mem = static_cast<uchar*>(block) - pad_bytes;
+
+            // safety check
+            for (size_t i = 0; i < pad_bytes; ++i)
+                if (mem[i] != Pattern::ALLOCATED)
+                    std::abort();
+
+            std::memset(mem, Pattern::UNALLOCATED, pad_bytes);
+
+            List* list = reinterpret_cast<List*>(mem + pad_bytes - header_size);
+            set_next(list, free_list_);
+            free_list_ = list;
+        }
+
+        /**
+         * @brief Usable bytes per block.
+         *
+         * @return size_t
+         */
+        static constexpr size_t BlockSize() noexcept
+        {
+            return block_size;
+        }
+
+        /**
+         * @brief Whether a pointer is the start of a block in this
+         *        allocator's arena.
+         *
+         * @param block
+         * @return true
+         * @return false
+         */
+        bool Owns(const void* block) const noexcept
+        {
+            const uchar* memory = static_cast<const uchar*>(block);
+
+            if (memory < data_.bytes + header_size || memory >= data_.bytes + bytes_allocated) return false;
+
+            return static_cast<size_t>(memory - data_.bytes - header_size) % hb_size == 0;
+        }
+
+        /**
+         * @brief Whether or not there is room for more allocations.
+         *
+         * @return true
+         * @return false
+         */
+        bool CanAllocate() const noexcept
+        {
+            return free_list_ || bump_ < blocks;
+        }
+
+        // prevent copying of any kind
+        StaticMemoryAllocator& operator=(StaticMemoryAllocator& rhs) = delete;
+        StaticMemoryAllocator(const StaticMemoryAllocator& rhs) = delete;
+        StaticMemoryAllocator(StaticMemoryAllocator&& rhs) = delete;
+
+    private:
+
+        /**
+         * @brief Reads a slot's link. Links may sit at addresses aligned to
+         *        less than their size, hence memcpy.
+         *
+         * @param list
+         * @return List*
+         */
+        List* next_of(const List* list) noexcept
+        {
+            Link link;
+            std::memcpy(&link, list, sizeof(Link));
+
+            if constexpr (std::is_pointer<Link>::value)
+                return static_cast<List*>(link);
+            else
+                return link ? reinterpret_cast<List*>(data_.bytes + (static_cast<size_t>(link) - 1) * hb_size) : nullptr;
+        }
+
+        /**
+         * @brief Writes a slot's link.
+         *
+         * @param list
+         * @param next
+         */
+        void set_next(List* list, const List* next) noexcept
+        {
+            Link link;
+
+            if constexpr (std::is_pointer<Link>::value)
+                link = const_cast<List*>(next);
+            else
+                link = next ? static_cast<Link>(static_cast<size_t>(reinterpret_cast<const uchar*>(next) - data_.bytes) / hb_size + 1) : Link(0);
+
+            std::memcpy(list, &link, sizeof(Link));
+        }
+    };
+}
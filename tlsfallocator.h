@@ -0,0 +1,390 @@
+/******************************************************************************/
+/*
+* @file   tlsfallocator.h
+* @author Aditya Harsh
+* @brief  Two-level segregated fit allocator: variable size, O(1) time.
+*/
+/******************************************************************************/
+
+#pragma once
+
+#include "osmemory.h" /* ATL::HeapStorage */
+
+#include <cstddef>   /* std::size_t        */
+#include <cstdint>   /* std::uint32_t      */
+#include <cstdlib>   /* std::abort         */
+#include <stdexcept> /* std::runtime_error */
+
+namespace ATL
+{
+    /**
+     * @brief TLSF allocator over one arena of `arena_size` bytes. Free blocks
+     *        are filed by size into a first level (power of two) and a second
+     *        level (16 linear steps within it), and a bitmap per level marks
+     *        the non-empty lists. Finding a fitting block is a couple of bit
+     *        scans and neighbours are merged immediately on free, so every
+     *        operation runs in constant time with no loops over lists or
+     *        orders, making it usable from hard real-time code.
+     *
+     *        Blocks carry a 16 byte header and payloads are 16-byte aligned.
+     *
+     * @tparam arena_size
+     * @tparam Storage HeapStorage, MappedStorage or HugePageStorage
+     */
+    template <size_t arena_size, typename Storage = HeapStorage>
+    class TlsfAllocator
+    {
+        // internal memory type
+        using uchar = unsigned char;
+
+        // physical block; the free list links overlay the payload
+        struct Block
+        {
+            Block* prev_phys;
+            // payload bytes, bit 0 set while free
+            size_t size;
+            Block* next_free;
+            Block* prev_free;
+        };
+
+        static constexpr size_t free_bit = 1;
+        static constexpr size_t header_size = 2 * sizeof(void*);
+        static constexpr size_t align_log2 = 4;
+        static constexpr size_t align = size_t(1) << align_log2;
+        static constexpr size_t min_payload = 2 * sizeof(void*);
+
+        // second level subdivisions per power of two
+        static constexpr size_t sl_log2 = 4;
+        static constexpr size_t sl_count = size_t(1) << sl_log2;
+
+        // sizes below this all share first level 0, in align-sized steps
+        static constexpr size_t fl_shift = sl_log2 + align_log2;
+        static constexpr size_t small_block = size_t(1) << fl_shift;
+
+        static constexpr size_t log2(size_t n) noexcept
+        {
+            return n > 1 ? 1 + log2(n >> 1) : 0;
+        }
+
+        static constexpr size_t fl_count = log2(arena_size) - fl_shift + 2;
+
+        // largest payload the arena holds, after its header and the sentinel
+        static constexpr size_t max_payload = (arena_size - 2 * header_size) / align * align;
+
+        // safety checking
+        static_assert(arena_size >= small_block, "Arena too small.");
+        static_assert(fl_count <= 64, "Arena too large.");
+        static_assert(sizeof(Block) == header_size + min_payload, "Unexpected block layout.");
+
+        // arena
+        uchar* data_;
+        // non-empty first levels, then non-empty second levels per first level
+        unsigned long long fl_bitmap_;
+        std::uint32_t sl_bitmap_[fl_count];
+        // free lists
+        Block* heads_[fl_count][sl_count];
+
+    public:
+
+        /**
+         * @brief Construct a new TLSF Allocator object. The arena starts out
+         *        as one free block followed by a permanently used sentinel.
+         *
+         */
+        TlsfAllocator() : data_(nullptr), fl_bitmap_(0), sl_bitmap_(), heads_()
+        {
+            data_ = static_cast<uchar*>(Storage::Acquire(arena_size));
+
+            Block* block = reinterpret_cast<Block*>(data_);
+            block->prev_phys = nullptr;
+            block->size = max_payload;
+
+            Block* sentinel = next_phys(block);
+            sentinel->prev_phys = block;
+            sentinel->size = 0;
+
+            insert(block);
+        }
+
+        /**
+         * @brief Destructor
+         *
+         */
+        ~TlsfAllocator() noexcept
+        {
+            Storage::Release(data_, arena_size);
+        }
+
+        /**
+         * @brief Allocates at least `size` bytes in constant time.
+         *
+         * @param size
+         * @return void*
+         */
+        void* Allocate(size_t size)
+        {
+            void* block = TryAllocate(size);
+
+            if (!block) throw std::runtime_error("Out of blocks.");
+
+            return block;
+        }
+
+        /**
+         * @brief Allocates at least `size` bytes in constant time, returning
+         *        nullptr instead of throwing when nothing fits.
+         *
+         * @param size
+         * @return void*
+         */
+        void* TryAllocate(size_t size) noexcept
+        {
+            if (size > max_payload) return nullptr;
+
+            size = size < min_payload ? min_payload : (size + align - 1) / align * align;
+
+            // round up to the next list boundary, so any block found fits
+            size_t fl, sl;
+            size_t search = size;
+            if (search >= small_block) search += (size_t(1) << (log2_of(search) - sl_log2)) - 1;
+            mapping(search, fl, sl);
+
+            Block* block = find(fl, sl);
+
+            // nothing larger, but the head of the exact list may still fit
+            if (!block)
+            {
+                mapping(size, fl, sl);
+                block = heads_[fl][sl];
+                if (!block || size_of(block) < size) return nullptr;
+            }
+
+            remove(block, fl, sl);
+
+            // give the tail back when it can stand on its own
+            const size_t available = size_of(block);
+            if (available - size >= header_size + min_payload)
+            {
+                block->size = size;
+
+                Block* rest = next_phys(block);
+                rest->prev_phys = block;
+                rest->size = available - size - header_size;
+                next_phys(rest)->prev_phys = rest;
+
+                insert(rest);
+            }
+            else
+            {
+                block->size = available;
+            }
+
+            return reinterpret_cast<uchar*>(block) + header_size;
+        }
+
+        /**
+         * @brief Frees a block in constant time, merging it with free
+         *        neighbours.
+         *
+         * @param block
+         */
+        void Free(void* block) noexcept
+        {
+            // safety check
+            if (!Owns(block) || (static_cast<uchar*>(block) - data_) % align) std::abort();
+
+            Block* b = reinterpret_cast<Block*>(static_cast<uchar*>(block) - header_size);
+
+            // double frees
+            if (b->size & free_bit) std::abort();
+
+            Block* next = next_phys(b);
+            if (next->size & free_bit)
+            {
+                remove(next);
+                b->size += header_size + size_of(next);
+                next_phys(b)->prev_phys = b;
+            }
+
+            Block* prev = b->prev_phys;
+            if (prev && (prev->size & free_bit))
+            {
+                remove(prev);
+                prev->size = size_of(prev) + header_size + b->size;
+                next_phys(prev)->prev_phys = prev;
+                b = prev;
+            }
+
+            insert(b);
+        }
+
+        /**
+         * @brief Largest single request the arena can serve.
+         *
+         * @return size_t
+         */
+        static constexpr size_t Capacity() noexcept
+        {
+            return max_payload;
+        }
+
+        /**
+         * @brief Whether a pointer lies inside this allocator's arena.
+         *
+         * @param block
+         * @return true
+         * @return false
+         */
+        bool Owns(const void* block) const noexcept
+        {
+            const uchar* memory = static_cast<const uchar*>(block);
+            return memory >= data_ + header_size && memory < data_ + arena_size;
+        }
+
+        // prevent copying of any kind
+        TlsfAllocator& operator=(TlsfAllocator& rhs) = delete;
+        TlsfAllocator(const TlsfAllocator& rhs) = delete;
+        TlsfAllocator(TlsfAllocator&& rhs) = delete;
+
+    private:
+
+        /**
+         * @brief Index of the highest set bit.
+         *
+         * @param n Non-zero.
+         * @return size_t
+         */
+        static size_t log2_of(size_t n) noexcept
+        {
+            return 63 - static_cast<size_t>(__builtin_clzll(n));
+        }
+
+        /**
+         * @brief First and second level list of a size.
+         *
+         * @param size
+         * @param fl
+         * @param sl
+         */
+        static void mapping(size_t size, size_t& fl, size_t& sl) noexcept
+        {
+            if (size < small_block)
+            {
+                fl = 0;
+                sl = size / align;
+            }
+            else
+            {
+                const size_t top = log2_of(size);
+                sl = (size >> (top - sl_log2)) ^ sl_count;
+                fl = top - fl_shift + 1;
+            }
+        }
+
+        /**
+         * @brief First block in the smallest non-empty list at or above
+         *        (fl, sl), updating fl and sl to that list.
+         *
+         * @param fl
+         * @param sl
+         * @return Block*
+         */
+        Block* find(size_t& fl, size_t& sl) const noexcept
+        {
+            if (fl >= fl_count) return nullptr;
+
+            std::uint32_t sl_map = sl_bitmap_[fl] & (~std::uint32_t(0) << sl);
+
+            if (!sl_map)
+            {
+                const unsigned long long fl_map = fl + 1 < 64 ? fl_bitmap_ & (~0ull << (fl + 1)) : 0;
+                if (!fl_map) return nullptr;
+
+                fl = static_cast<size_t>(__builtin_ctzll(fl_map));
+                sl_map = sl_bitmap_[fl];
+            }
+
+            sl = static_cast<size_t>(__builtin_ctz(sl_map));
+            return heads_[fl][sl];
+        }
+
+        /**
+         * @brief Files a block as free.
+         *
+         * @param block
+         */
+        void insert(Block* block) noexcept
+        {
+            size_t fl, sl;
+            mapping(size_of(block), fl, sl);
+
+            Block*& head = heads_[fl][sl];
+
+            block->size |= free_bit;
+            block->prev_free = nullptr;
+            block->next_free = head;
+            if (head) head->prev_free = block;
+            head = block;
+
+            fl_bitmap_ |= 1ull << fl;
+            sl_bitmap_[fl] |= std::uint32_t(1) << sl;
+        }
+
+        /**
+         * @brief Takes a free block out of its list.
+         *
+         * @param block
+         */
+        void remove(Block* block) noexcept
+        {
+            size_t fl, sl;
+            mapping(size_of(block), fl, sl);
+            remove(block, fl, sl);
+        }
+
+        /**
+         * @brief Takes a free block out of a known list.
+         *
+         * @param block
+         * @param fl
+         * @param sl
+         */
+        void remove(Block* block, size_t fl, size_t sl) noexcept
+        {
+            if (block->prev_free) block->prev_free->next_free = block->next_free;
+            else heads_[fl][sl] = block->next_free;
+
+            if (block->next_free) block->next_free->prev_free = block->prev_free;
+
+            if (!heads_[fl][sl])
+            {
+                sl_bitmap_[fl] &= ~(std::uint32_t(1) << sl);
+                if (!sl_bitmap_[fl]) fl_bitmap_ &= ~(1ull << fl);
+            }
+
+            block->size &= ~free_bit;
+        }
+
+        /**
+         * @brief Payload bytes of a block, without the flag.
+         *
+         * @param block
+         * @return size_t
+         */
+        static size_t size_of(const Block* block) noexcept
+        {
+            return block->size & ~free_bit;
+        }
+
+        /**
+         * @brief Block physically following another.
+         *
+         * @param block
+         * @return Block*
+         */
+        static Block* next_phys(const Block* block) noexcept
+        {
+            return reinterpret_cast<Block*>(reinterpret_cast<uchar*>(const_cast<Block*>(block)) + header_size + size_of(block));
+        }
+    };
+}